@@ -0,0 +1,106 @@
+#ifndef QS_ADJACENCYINDEX_H
+#define QS_ADJACENCYINDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Non-owning view of a contiguous array (points into a vector or into a mapped file).
+ */
+template<typename T>
+struct ArrayView {
+    const T *ptr = nullptr;
+    size_t len = 0;
+
+    ArrayView() = default;
+    ArrayView(const T *p, size_t n) : ptr(p), len(n) {}
+    ArrayView(const std::vector<T> &v) : ptr(v.data()), len(v.size()) {}
+
+    const T *begin() const { return ptr; }
+    const T *end() const { return ptr + len; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const T &operator[](size_t i) const { return ptr[i]; }
+};
+
+/*
+ * Edges of one direction grouped by label, then by (source) vertex, in compressed sparse row form:
+ *  - labelOffsets (L + 1): label l owns the entries [labelOffsets[l], labelOffsets[l + 1]) of vertices
+ *  - vertices: the vertices with at least one edge of the label, ascending
+ *  - edgeOffsets (vertices + 1): vertex entry i owns [edgeOffsets[i], edgeOffsets[i + 1]) of targets
+ *  - targets: neighbours, ascending and without duplicates per (label, vertex)
+ */
+class AdjacencyIndex {
+
+    std::vector<uint64_t> labelOffsetsData;
+    std::vector<uint32_t> verticesData;
+    std::vector<uint64_t> edgeOffsetsData;
+    std::vector<uint32_t> targetsData;
+
+    std::vector<uint64_t> labelEdgeOffsets; // first target of every label, only needed while building
+
+    void allocate(const std::vector<uint64_t> &noVertices, const std::vector<uint64_t> &noEdges);
+    void fill(uint32_t label, const std::vector<uint64_t> &bucket);
+    void publish();
+
+public:
+
+    // edges of one label packed as (vertex << 32 | neighbour), so that sorting the keys sorts the pairs
+    using EdgeBucket = std::vector<uint64_t>;
+
+    static uint64_t edgeKey(uint32_t vertex, uint32_t neighbour) {
+        return ((uint64_t) vertex << 32) | neighbour;
+    }
+
+    ArrayView<uint64_t> labelOffsets;
+    ArrayView<uint32_t> vertices;
+    ArrayView<uint64_t> edgeOffsets;
+    ArrayView<uint32_t> targets;
+
+    AdjacencyIndex() = default;
+    AdjacencyIndex(const AdjacencyIndex &) = delete;
+    AdjacencyIndex &operator=(const AdjacencyIndex &) = delete;
+
+    /*
+     * Build from per-label (vertex, neighbour) buckets, labels are processed in parallel.
+     * The buckets are consumed.
+     */
+    void build(std::vector<EdgeBucket> &buckets, uint32_t noThreads = 1);
+
+    /*
+     * Build the reverse direction of another index.
+     */
+    void buildTransposed(const AdjacencyIndex &other, uint32_t noThreads = 1);
+
+    /*
+     * Use externally owned arrays (e.g. from a mapped snapshot) instead of building.
+     */
+    void attach(ArrayView<uint64_t> labelOffsets, ArrayView<uint32_t> vertices,
+                ArrayView<uint64_t> edgeOffsets, ArrayView<uint32_t> targets);
+
+    uint32_t getNoLabels() const { return labelOffsets.empty() ? 0 : (uint32_t) labelOffsets.size() - 1; }
+    uint64_t getNoEdges() const { return targets.size(); }
+
+    uint64_t getNoEdges(uint32_t label) const {
+        if (label >= getNoLabels()) return 0;
+        return edgeOffsets[labelOffsets[label + 1]] - edgeOffsets[labelOffsets[label]];
+    }
+
+    // vertices with at least one edge of the label
+    ArrayView<uint32_t> sources(uint32_t label) const {
+        if (label >= getNoLabels()) return {};
+        return {vertices.ptr + labelOffsets[label], labelOffsets[label + 1] - labelOffsets[label]};
+    }
+
+    // neighbours of the i-th entry of vertices
+    ArrayView<uint32_t> neighboursAt(uint64_t i) const {
+        return {targets.ptr + edgeOffsets[i], edgeOffsets[i + 1] - edgeOffsets[i]};
+    }
+
+    // neighbours of a vertex over one label (binary search over the vertices of the label)
+    ArrayView<uint32_t> neighbours(uint32_t label, uint32_t vertex) const;
+
+};
+
+#endif //QS_ADJACENCYINDEX_H
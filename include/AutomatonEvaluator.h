@@ -0,0 +1,68 @@
+#ifndef QS_AUTOMATONEVALUATOR_H
+#define QS_AUTOMATONEVALUATOR_H
+
+#include <memory>
+#include <vector>
+#include "Evaluator.h"
+#include "Query.h"
+#include "SimpleGraph.h"
+#include "ThreadPool.h"
+#include "VisitedSet.h"
+
+class CardinalityCounter;
+
+/*
+ * Path e0/e1/.../en-1 as a nondeterministic automaton without epsilon moves. State i means "e0..ei-1
+ * matched": every label of ei moves from state i to state i + 1, and if ei is a Kleene entry its labels
+ * also loop on state i + 1. State 0 is the start state, state n the only accepting one.
+ */
+struct PathAutomaton {
+
+    struct Transition {
+        LabelDir labelDir;
+        uint32_t to;
+    };
+
+    std::vector<std::vector<Transition>> transitions; // per state
+
+    explicit PathAutomaton(const std::vector<PathEntry> &path);
+
+    uint32_t getNoStates() const { return (uint32_t) transitions.size(); }
+    uint32_t accepting() const { return getNoStates() - 1; }
+
+};
+
+/*
+ * Evaluates a path query as a search over the product of the graph and the automaton of its path:
+ * from every start vertex the (vertex, state) pairs are explored once each, following the PSO/POS
+ * index for every transition, and the vertices reached in the accepting state are the targets of that
+ * start vertex. Unions and closures are just transitions, so nothing but the answer counts is kept.
+ */
+class AutomatonEvaluator : public Evaluator {
+
+    std::shared_ptr<SimpleGraph> graph;
+    std::shared_ptr<ThreadPool> pool;
+
+    // scratch of one search, reused by the next search on the same thread
+    struct Search {
+        std::vector<VisitedSet> visited; // per state
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // (vertex, state) still to expand
+        std::vector<uint32_t> reached;
+    };
+
+    void search(const PathAutomaton &automaton, uint32_t start, Search &s);
+    void countFrom(const PathAutomaton &automaton, const std::vector<uint32_t> &starts, CardinalityCounter &counter);
+
+public:
+
+    explicit AutomatonEvaluator(std::shared_ptr<SimpleGraph> &g);
+    ~AutomatonEvaluator() = default;
+
+    void prepare() override ;
+    cardStat evaluate(const Triple &query) override ;
+
+    void setNoThreads(uint32_t noThreads);
+
+};
+
+#endif //QS_AUTOMATONEVALUATOR_H
@@ -1,12 +1,61 @@
 #ifndef QS_BENCHES_H
 #define QS_BENCHES_H
 #include <string>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 struct benchresult_t {
     long prepTime, evalTime, loadTime;
+    long textualEvalTime; // only with --join-order compare: eval time with the textual join order
+    long automatonEvalTime; // only with --engine compare: eval time of the automaton engine
+    std::vector<std::pair<std::string, long>> queryTimes; // (query, eval time) in workload order
 };
 
-struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queriesFile);
-int estimatorBench(std::string &graphFile, std::string &queriesFile);
+struct estimatorquery_t {
+    std::string query;
+    std::string queryClass; // single, chain, union, closure or bound (an endpoint is a constant)
+    uint32_t estimate[3], actual[3]; // (noOut, noPaths, noIn)
+    double qError; // of noPaths: max(estimate / actual, actual / estimate), both at least 1
+    double latencyUs; // per estimate
+};
+
+struct estimatorresult_t {
+    std::string graphFile, queriesFile;
+    double loadTime, prepTime; // ms, prepTime builds the statistics catalog and the label-pair synopsis
+    uint64_t statsBytes; // catalog + synopsis
+    std::vector<estimatorquery_t> queries; // in workload order
+};
+
+struct benchconfig_t {
+    std::string mode = "evaluator"; // evaluator (time the evaluation) or estimator (accuracy and latency of the estimates)
+    uint32_t loadThreads = 0; // threads used to parse the graph file, 0 = one per hardware thread
+    std::string joinOrder = "planned"; // planned, textual, or compare (run both and report both times)
+    std::string engine = "relational"; // relational (SimpleEvaluator), automaton (AutomatonEvaluator), or compare
+    uint32_t evalThreads = 0; // threads of the evaluator's pool, 0 = one per hardware thread
+    uint64_t cacheMiB = 256; // memory budget of the evaluator's sub-plan cache
+    bool approximate = false; // count the distinct targets of an answer with a HyperLogLog sketch
+    bool batch = false; // evaluate the workload at once (SimpleEvaluator::evaluateBatch) instead of query by query
+    uint32_t concurrency = 1; // queries evaluated at once by a pool of workers sharing the graph and the evaluator
+    uint64_t sampleBudget = 0; // edge visits per sampled estimate (long paths and closures), 0 = no sampling
+    uint64_t seed = 1; // of the estimator's sampling
+    std::string jsonFile; // estimator mode: also write the report as JSON to this file
+    std::vector<uint32_t> speedupThreads; // benchmarker only: rerun every workload with these thread counts
+};
+
+// parse the optional "--option value" arguments starting at argv[first], returns false on bad input
+bool parseBenchOptions(int argc, char *argv[], int first, struct benchconfig_t &config);
+void printBenchOptions();
+
+// convert a graph.nt file into a binary snapshot that can be passed wherever a graph file is expected
+int convertGraph(std::string &graphFile, std::string &snapshotFile, const struct benchconfig_t &config);
+
+struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queriesFile, const struct benchconfig_t &config);
+struct estimatorresult_t estimatorBench(std::string &graphFile, std::string &queriesFile, const struct benchconfig_t &config);
+
+// q-error and latency per query class over the workloads
+void printEstimatorSummary(const std::vector<struct estimatorresult_t> &results);
+// the same as JSON, with every query of every workload; returns false if the file cannot be written
+bool writeEstimatorJson(const std::string &fileName, const std::vector<struct estimatorresult_t> &results, const struct benchconfig_t &config);
 
 #endif //QS_BENCHES_H
@@ -0,0 +1,70 @@
+#ifndef QS_BITMATRIX_H
+#define QS_BITMATRIX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/*
+ * Rows of bitsets over the vertices, for dense relations: a join becomes a boolean matrix product where
+ * the row of a left source is the OR of the rows of its targets. Every row is padded to a multiple of
+ * 512 bits and 64-byte aligned, so the OR kernels (AVX-512, AVX2 or portable, picked once at run time)
+ * always work on full vector registers.
+ */
+class BitMatrix {
+
+    struct Free {
+        void operator()(uint64_t *p) const { std::free(p); }
+    };
+
+public:
+
+    using Words = std::unique_ptr<uint64_t[], Free>;
+
+    // bits per row are padded to this (in 64-bit words)
+    static constexpr size_t WORDS_PER_BLOCK = 8;
+
+private:
+
+    size_t stride = 0; // words per row
+    size_t noRows = 0;
+    Words bits;
+
+public:
+
+    BitMatrix() = default;
+
+    // noRows zeroed rows over noColumns vertices
+    BitMatrix(uint32_t noColumns, size_t noRows);
+
+    // words of a row of a relation over noColumns vertices
+    static size_t strideFor(uint32_t noColumns) {
+        return (noColumns + 64 * WORDS_PER_BLOCK - 1) / (64 * WORDS_PER_BLOCK) * WORDS_PER_BLOCK;
+    }
+
+    // a zeroed, 64-byte aligned buffer of (at least) the given number of words, e.g. the accumulator of a join
+    static Words allocateWords(size_t words);
+
+    size_t getStride() const { return stride; }
+    size_t getNoRows() const { return noRows; }
+
+    uint64_t *row(size_t i) { return bits.get() + i * stride; }
+    const uint64_t *row(size_t i) const { return bits.get() + i * stride; }
+
+    // acc |= row over stride words (a multiple of WORDS_PER_BLOCK, both 64-byte aligned)
+    static void orInto(uint64_t *acc, const uint64_t *row, size_t stride);
+
+    // append the set bits of a row, ascending
+    static void appendBits(const uint64_t *bits, size_t stride, std::vector<uint32_t> &out) {
+        for (size_t w = 0; w < stride; w++) {
+            for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                out.push_back((uint32_t) (w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+};
+
+#endif //QS_BITMATRIX_H
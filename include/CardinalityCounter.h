@@ -0,0 +1,118 @@
+#ifndef QS_CARDINALITYCOUNTER_H
+#define QS_CARDINALITYCOUNTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Estimator.h"
+#include "HyperLogLog.h"
+
+/*
+ * Sink for the last operator of a plan: takes the answer one source at a time and keeps
+ * only the distinct-source, distinct-pair and distinct-target counts. An approximate counter keeps
+ * the targets in a HyperLogLog sketch instead of a bitset over all vertices: the distinct-target count is
+ * then within the sketch's error, the other two stay exact.
+ */
+class CardinalityCounter {
+
+    std::vector<uint64_t> targetBits; // targets seen so far
+    HyperLogLog targetSketch;         // the same, approximate counter
+    uint32_t noVertices;
+    bool approximate;
+
+    uint64_t noOut = 0;
+    uint64_t noPaths = 0;
+    uint64_t noIn = 0;
+
+public:
+
+    explicit CardinalityCounter(uint32_t noVertices, bool approximate = false)
+            : targetBits(approximate ? 0 : (noVertices + 63) / 64),
+              targetSketch(approximate ? HyperLogLog::DEFAULT_PRECISION : 0),
+              noVertices(noVertices), approximate(approximate) {}
+
+    // an empty counter for the same vertices, e.g. to count a part of the answer on another thread
+    CardinalityCounter emptyLike() const {
+        return CardinalityCounter(noVertices, approximate);
+    }
+
+    /*
+     * Add the counts of another counter of the same shape. The sources counted by both must be disjoint.
+     */
+    void merge(const CardinalityCounter &other) {
+        noOut += other.noOut;
+        noPaths += other.noPaths;
+        if (approximate) {
+            targetSketch.merge(other.targetSketch);
+            return;
+        }
+        for (size_t i = 0; i < targetBits.size(); i++) {
+            noIn += (uint64_t) __builtin_popcountll(other.targetBits[i] & ~targetBits[i]);
+            targetBits[i] |= other.targetBits[i];
+        }
+    }
+
+    /*
+     * Count one source and its targets. The targets must be distinct, every source may be added only once.
+     */
+    template<typename It>
+    void addSource(It begin, It end) {
+        uint64_t n = 0;
+        if (approximate) {
+            for (; begin != end; ++begin) {
+                targetSketch.insert(*begin);
+                n++;
+            }
+        } else {
+            for (; begin != end; ++begin) {
+                uint32_t target = *begin;
+                uint64_t bit = 1ULL << (target & 63);
+                uint64_t &word = targetBits[target >> 6];
+                noIn += (word & bit) == 0;
+                word |= bit;
+                n++;
+            }
+        }
+
+        noOut += n != 0;
+        noPaths += n;
+    }
+
+    /*
+     * Count one source whose targets are given as a bitset over the vertices (zero beyond them).
+     */
+    void addSourceBits(const uint64_t *bits, size_t words) {
+        uint64_t n = 0;
+        if (approximate) {
+            for (size_t i = 0; i < words; i++) {
+                for (auto word = bits[i]; word != 0; word &= word - 1) {
+                    targetSketch.insert((uint32_t) (i * 64 + __builtin_ctzll(word)));
+                    n++;
+                }
+            }
+        } else {
+            words = std::min(words, targetBits.size());
+            for (size_t i = 0; i < words; i++) {
+                n += (uint64_t) __builtin_popcountll(bits[i]);
+                noIn += (uint64_t) __builtin_popcountll(bits[i] & ~targetBits[i]);
+                targetBits[i] |= bits[i];
+            }
+        }
+
+        noOut += n != 0;
+        noPaths += n;
+    }
+
+    cardStat result() const {
+        auto in = noIn;
+        if (approximate) {
+            // at least one target if there is a path, never more than the paths or the vertices
+            in = std::min<uint64_t>({(uint64_t) std::llround(targetSketch.estimate()), noPaths, noVertices});
+            in = std::max<uint64_t>(in, noPaths != 0);
+        }
+        return cardStat {(uint32_t) noOut, (uint32_t) noPaths, (uint32_t) in};
+    }
+
+};
+
+#endif //QS_CARDINALITYCOUNTER_H
@@ -0,0 +1,64 @@
+#ifndef QS_CONDENSEDCLOSURE_H
+#define QS_CONDENSEDCLOSURE_H
+
+#include <cstdint>
+#include <vector>
+#include "AdjacencyIndex.h"
+#include "Estimator.h"
+#include "Relation.h"
+
+/*
+ * Transitive closure of a relation kept in condensed form. The strongly connected components (SCCs)
+ * of the relation are computed first; all vertices of a component reach exactly the same vertices,
+ * so reachability is stored once per component, as the list of components it reaches:
+ *  - componentOf: vertex -> component, components are numbered in reverse topological order
+ *  - members: vertices grouped by component (memberOffsets, C + 1), ascending within a component
+ *  - reach: components reachable over one or more edges (reachOffsets, C + 1), ascending;
+ *    a component reaches itself iff it lies on a cycle
+ * A dense (l>)+ over one large SCC of k vertices thus costs O(k) memory instead of O(k^2).
+ */
+class CondensedClosure {
+
+    std::vector<uint32_t> componentOf;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> members;
+    std::vector<uint64_t> reachOffsets;
+    std::vector<uint32_t> reach;
+
+    std::vector<uint64_t> noReachable; // vertices reachable from every component
+    std::vector<char> hasPredecessor;   // component is the target of at least one edge
+
+    void findComponents(const Relation &base);
+    void condense(const Relation &base);
+
+public:
+
+    // base must be in LISTS layout
+    explicit CondensedClosure(const Relation &base);
+
+    uint32_t getNoComponents() const { return (uint32_t) memberOffsets.size() - 1; }
+    uint32_t component(uint32_t vertex) const { return componentOf[vertex]; }
+
+    ArrayView<uint32_t> componentMembers(uint32_t c) const {
+        return {members.data() + memberOffsets[c], memberOffsets[c + 1] - memberOffsets[c]};
+    }
+
+    ArrayView<uint32_t> reachable(uint32_t c) const {
+        return {reach.data() + reachOffsets[c], reachOffsets[c + 1] - reachOffsets[c]};
+    }
+
+    // vertices reachable from the component
+    uint64_t getNoReachable(uint32_t c) const { return noReachable[c]; }
+
+    // the closure row of every vertex of the component, sorted
+    void row(uint32_t c, std::vector<uint32_t> &out) const;
+
+    // cardinality of the closure, derived per component without listing the pairs
+    cardStat stats() const;
+
+    // memory held by the closure
+    uint64_t getNoBytes() const;
+
+};
+
+#endif //QS_CONDENSEDCLOSURE_H
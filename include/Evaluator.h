@@ -10,7 +10,7 @@ class Evaluator {
 
 public:
     virtual void prepare() = 0;
-    virtual cardStat evaluate(Triple &query) = 0;
+    virtual cardStat evaluate(const Triple &query) = 0;
 
 };
 
@@ -0,0 +1,142 @@
+#ifndef QS_GRAPHPARSER_H
+#define QS_GRAPHPARSER_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/*
+ * graph ::= header '\n' ( edge? '\r'? '\n' )*
+ * header ::= number ',' number ',' number           (noNodes,noEdges,noLabels)
+ * edge ::= number ws+ number ws+ number ws+ '.' ws*  (subject predicate object .)
+ * ws ::= ' ' | '\t'
+ * number ::= [0-9]+
+ */
+
+struct GraphHeader {
+    uint32_t noNodes;
+    uint32_t noEdges;
+    uint32_t noLabels;
+};
+
+/*
+ * Scans graph.nt directly from memory (usually a MappedFile), no regex and no per-line copies.
+ */
+class GraphParser {
+
+    const char *_cur;
+    const char *_end;
+    uint64_t _line;
+
+public:
+
+    GraphParser(const char *begin, const char *end, uint64_t firstLine = 1)
+            : _cur(begin), _end(end), _line(firstLine) {}
+
+    /*
+     * Parse the first line. Throws on a malformed header.
+     */
+    GraphHeader header();
+
+    /*
+     * Parse the next edge, skipping empty lines. Throws on a malformed line.
+     * @return false at the end of the input.
+     */
+    inline bool nextEdge(uint32_t &subject, uint32_t &predicate, uint32_t &object);
+
+    const char *position() const { return _cur; }
+    uint64_t line() const { return _line; }
+
+private:
+
+    inline bool number(uint32_t &out);
+
+    inline bool blanks() {
+        const char *start = _cur;
+        while (_cur < _end && (*_cur == ' ' || *_cur == '\t')) _cur++;
+        return _cur != start;
+    }
+
+    inline bool endOfLine() {
+        while (_cur < _end && (*_cur == ' ' || *_cur == '\t' || *_cur == '\r')) _cur++;
+        if (_cur == _end) return true;
+        if (*_cur != '\n') return false;
+        _cur++;
+        return true;
+    }
+
+    [[noreturn]] void malformed() const {
+        throw std::runtime_error(std::string("Invalid graph edge at line ") + std::to_string(_line) + "!");
+    }
+
+};
+
+/*
+ * Reads an unsigned decimal. Eight bytes are classified and converted at once (SWAR),
+ * the byte-wise loop only handles the tail of the buffer and numbers longer than eight digits.
+ */
+inline bool GraphParser::number(uint32_t &out) {
+    uint64_t value = 0;
+    const char *start = _cur;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (_end - _cur >= 8) {
+        uint64_t digits;
+        std::memcpy(&digits, _cur, 8);
+        digits ^= 0x3030303030303030ULL; // '0'..'9' -> 0..9, everything else -> >= 10
+
+        // high bit of each byte set iff the byte is not a digit
+        uint64_t nonDigit = (((digits & 0x7F7F7F7F7F7F7F7FULL) + 0x7676767676767676ULL) | digits)
+                            & 0x8080808080808080ULL;
+        unsigned n = nonDigit ? (unsigned) __builtin_ctzll(nonDigit) / 8 : 8;
+        if (n == 0) return false;
+
+        // move the digits to the top, the vacated low bytes act as leading zeros
+        if (n < 8) digits <<= 8 * (8 - n);
+        digits = (digits * 10) + (digits >> 8);
+        digits = (((digits & 0x000000FF000000FFULL) * 0x000F424000000064ULL)
+                  + (((digits >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32;
+
+        value = digits;
+        _cur += n;
+        if (n < 8) {
+            out = (uint32_t) value;
+            return true;
+        }
+    }
+#endif
+
+    while (_cur < _end && '0' <= *_cur && *_cur <= '9') {
+        value = value * 10 + (uint64_t) (*_cur - '0');
+        if (value > UINT32_MAX) return false;
+        _cur++;
+    }
+    if (_cur == start) return false;
+
+    out = (uint32_t) value;
+    return true;
+}
+
+inline bool GraphParser::nextEdge(uint32_t &subject, uint32_t &predicate, uint32_t &object) {
+    // skip empty lines
+    while (_cur < _end && (*_cur == '\n' || *_cur == '\r' || *_cur == ' ' || *_cur == '\t')) {
+        if (*_cur == '\n') _line++;
+        _cur++;
+    }
+    if (_cur == _end) return false;
+
+    if (!number(subject) || !blanks()
+        || !number(predicate) || !blanks()
+        || !number(object) || !blanks()
+        || _cur == _end || *_cur != '.') {
+        malformed();
+    }
+    _cur++;
+    if (!endOfLine()) malformed();
+
+    _line++;
+    return true;
+}
+
+#endif //QS_GRAPHPARSER_H
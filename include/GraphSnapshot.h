@@ -0,0 +1,59 @@
+#ifndef QS_GRAPHSNAPSHOT_H
+#define QS_GRAPHSNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SimpleGraph;
+
+/*
+ * Binary image of a loaded SimpleGraph. Layout (little-endian, every section 8-byte aligned):
+ *
+ *  header    magic, version, flags, vertex/label/edge counts, payload size and checksum, section table
+ *  sections  labelOffsets, vertices, edgeOffsets, targets of the forward (PSO) CSR,
+ *            the same four arrays of the backward (POS) CSR
+ *
+ * The checksum covers everything after the header. On read the indexes are also checked to be well formed
+ * (ascending offsets, vertices and targets within the vertex count), so a corrupt file fails to load rather
+ * than being read out of bounds later.
+ */
+class GraphSnapshot {
+
+public:
+
+    static constexpr char MAGIC[8] = {'Q', 'S', 'G', 'R', 'A', 'P', 'H', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    enum Section : uint32_t {
+        PSO_LABEL_OFFSETS, PSO_VERTICES, PSO_EDGE_OFFSETS, PSO_TARGETS,
+        POS_LABEL_OFFSETS, POS_VERTICES, POS_EDGE_OFFSETS, POS_TARGETS,
+        NO_SECTIONS
+    };
+
+    struct SectionEntry {
+        uint64_t offset; // from the start of the file
+        uint64_t size;   // in bytes, without padding
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags; // none defined yet, always 0
+        uint32_t noVertices;
+        uint32_t noLabels;
+        uint64_t noEdges;
+        uint64_t payloadSize;
+        uint64_t checksum;
+        SectionEntry sections[NO_SECTIONS];
+    };
+
+    // does the file start with the snapshot magic?
+    static bool isSnapshot(const std::string &fileName);
+
+    static void write(const SimpleGraph &g, const std::string &fileName);
+    static void read(SimpleGraph &g, const std::string &fileName);
+
+};
+
+#endif //QS_GRAPHSNAPSHOT_H
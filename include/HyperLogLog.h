@@ -0,0 +1,81 @@
+#ifndef QS_HYPERLOGLOG_H
+#define QS_HYPERLOGLOG_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * HyperLogLog sketch of a set of vertices (or of any 64-bit keys, e.g. vertex pairs): a hash picks one
+ * of 2^precision registers, which keeps the longest run of leading zeros seen in the rest of the hashes
+ * that picked it. The sketch has a fixed size however many vertices go in, and two sketches of the same
+ * precision merge into the sketch of the union by taking the larger of every register.
+ * A count is off by about relativeError() (one standard error); while many registers are still empty
+ * it is read from how many (linear counting), close to exact.
+ * A sketch of precision 0 has no registers, it counts 0 and nothing may be inserted into it.
+ */
+class HyperLogLog {
+
+    std::vector<uint8_t> registers;
+    uint8_t precision = 0;
+
+public:
+
+    static constexpr uint8_t DEFAULT_PRECISION = 14; // 16 KiB, 0.8% standard error
+
+    HyperLogLog() = default;
+    // precision 4 to 18: below, the bias correction no longer holds; above, the sketch is no longer small
+    explicit HyperLogLog(uint8_t precision) : registers(precision ? (size_t) 1 << precision : 0, 0), precision(precision) {}
+
+    uint8_t getPrecision() const { return precision; }
+
+    static uint64_t hash(uint64_t key) {
+        uint64_t h = key + 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    void insert(uint64_t key) {
+        auto h = hash(key);
+        auto &r = registers[h >> (64 - precision)];
+        // the bit below the register index ends the run, so a run never reaches into the index
+        auto rank = (uint8_t) (__builtin_clzll(h << precision | 1ULL << (precision - 1)) + 1);
+        r = std::max(r, rank);
+    }
+
+    // make this the sketch of the union with another sketch of the same precision
+    void merge(const HyperLogLog &other) {
+        for(size_t i = 0; i < registers.size(); i++) registers[i] = std::max(registers[i], other.registers[i]);
+    }
+
+    void clear() {
+        std::fill(registers.begin(), registers.end(), 0);
+    }
+
+    double estimate() const {
+        if(registers.empty()) return 0;
+        double m = (double) registers.size();
+        uint32_t counts[64] = {};
+        for(auto r : registers) counts[r]++;
+        double sum = 0;
+        for(int r = 0; r < 64; r++) sum += std::ldexp((double) counts[r], -r);
+        auto noZeros = counts[0];
+        double alpha = precision >= 7 ? 0.7213 / (1 + 1.079 / m) : precision == 6 ? 0.709 : precision == 5 ? 0.697 : 0.673;
+        double e = alpha * m * m / sum;
+        if(e <= 2.5 * m && noZeros > 0) e = m * std::log(m / noZeros);
+        return e;
+    }
+
+    static double relativeError(uint8_t precision) {
+        return precision ? 1.04 / std::sqrt(std::ldexp(1.0, precision)) : 0;
+    }
+
+    double relativeError() const { return relativeError(precision); }
+
+    uint64_t getNoBytes() const { return registers.capacity(); }
+
+};
+
+#endif //QS_HYPERLOGLOG_H
@@ -0,0 +1,55 @@
+#ifndef QS_JOINPLANNER_H
+#define QS_JOINPLANNER_H
+
+#include <string>
+#include <vector>
+#include "Query.h"
+#include "Estimator.h"
+
+class SimpleEstimator;
+
+/*
+ * Join order for a concatenation e0/e1/.../en-1. Every sub-path [i, j] with i < j is joined from
+ * [i, split(i, j)] and [split(i, j) + 1, j], so a plan describes left-deep, right-deep and bushy
+ * orders alike.
+ */
+class JoinPlan {
+
+    uint32_t n = 0;
+    std::vector<uint32_t> splits; // n x n, only i < j is used
+
+public:
+
+    JoinPlan() = default;
+    explicit JoinPlan(uint32_t noEntries) : n(noEntries), splits((size_t) noEntries * noEntries, 0) {}
+
+    uint32_t getNoEntries() const { return n; }
+    uint32_t split(uint32_t i, uint32_t j) const { return splits[(size_t) i * n + j]; }
+    void setSplit(uint32_t i, uint32_t j, uint32_t k) { splits[(size_t) i * n + j] = k; }
+
+    double cost = 0; // estimated number of paths probed with and produced by all joins
+
+    // the plan as a parenthesized path, e.g. (0>/(1>/2>))
+    std::string toString(const std::vector<PathEntry> &path) const;
+
+    // the textual (left-deep) order
+    static JoinPlan leftDeep(uint32_t noEntries);
+
+};
+
+/*
+ * Cost-based join ordering: dynamic programming over all sub-paths of a concatenation. The cardinality
+ * of a sub-path comes from the estimator (singleOperation/Union/transClosure for an entry,
+ * concatenation for longer sub-paths), the cost of a plan is the number of paths its joins probe
+ * with and produce, where the right children of the pipelined left spine are only charged if they
+ * are materialized.
+ */
+class JoinPlanner {
+
+public:
+
+    static JoinPlan plan(SimpleEstimator &est, const std::vector<PathEntry> &path);
+
+};
+
+#endif //QS_JOINPLANNER_H
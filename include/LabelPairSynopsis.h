@@ -0,0 +1,67 @@
+#ifndef QS_LABELPAIRSYNOPSIS_H
+#define QS_LABELPAIRSYNOPSIS_H
+
+#include <cstdint>
+#include <vector>
+#include "Query.h"
+#include "SimpleGraph.h"
+#include "StatisticsCatalog.h"
+
+/*
+ * Exact statistics of the 2-paths a/b for every pair of frequent label directions (a label read forward
+ * or backward): how many a-edges join b-edges, and how many distinct sources and targets the joined paths
+ * have. Only the labels with the most edges are covered, at most MAX_LABEL_DIRS label directions, so the
+ * synopsis stays a few dozen KiB however many labels the graph has; pairs with a rarer label are left to
+ * the estimator's independence assumption. The joined edges are always exact, the distinct endpoints of a
+ * label with more than SAMPLE_EDGES edges are counted on a sample of its vertices.
+ */
+class LabelPairSynopsis {
+
+public:
+
+    static constexpr uint32_t MAX_LABEL_DIRS = 64; // one bit each in a vertex mask
+    static constexpr uint8_t NO_SLOT = 0xff;
+    static constexpr uint64_t SWEEP_GRAIN = 1u << 16; // vertices per task when joining the edges of all pairs
+    static constexpr uint64_t SAMPLE_EDGES = 1u << 16; // per label direction, beyond it distinct endpoints are sampled
+
+    struct PairStats {
+        uint64_t noOut = 0;   // distinct sources of a/b
+        uint64_t noPaths = 0; // (a-edge, b-edge) pairs that meet, i.e. a/b with a path counted once per middle vertex
+        uint64_t noIn = 0;    // distinct targets of a/b
+    };
+
+private:
+
+    std::vector<LabelDir> labelDirs; // covered, per slot
+    std::vector<uint8_t> slots;      // per label direction (label << 1 | reverse): its slot, or NO_SLOT
+    std::vector<PairStats> pairs;    // slot of a * number of slots + slot of b
+
+    uint8_t slotOf(LabelDir labelDir) const {
+        auto i = (size_t) labelDir.label << 1 | labelDir.reverse;
+        return i < slots.size() ? slots[i] : NO_SLOT;
+    }
+
+public:
+
+    /*
+     * Pick the label directions to cover (by the edge counts of the catalog) and count all their pairs,
+     * every label direction a task of its own. 0 threads means one per hardware thread.
+     */
+    void build(const SimpleGraph &g, const StatisticsCatalog &catalog, uint32_t noThreads = 0);
+
+    // the statistics of first/second, or nullptr if one of them is not covered
+    const PairStats *pair(LabelDir first, LabelDir second) const {
+        auto a = slotOf(first), b = slotOf(second);
+        if(a == NO_SLOT || b == NO_SLOT) return nullptr;
+        return &pairs[(size_t) a * labelDirs.size() + b];
+    }
+
+    uint32_t getNoLabelDirs() const { return (uint32_t) labelDirs.size(); }
+
+    uint64_t getNoBytes() const {
+        return labelDirs.capacity() * sizeof(LabelDir) + slots.capacity() + pairs.capacity() * sizeof(PairStats);
+    }
+
+};
+
+#endif //QS_LABELPAIRSYNOPSIS_H
@@ -0,0 +1,32 @@
+#ifndef QS_MAPPEDFILE_H
+#define QS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Read-only memory mapping of a whole file. The mapping lives as long as the object.
+ */
+class MappedFile {
+
+    int fd = -1;
+    void *addr = nullptr;
+    size_t len = 0;
+
+public:
+
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return static_cast<const char *>(addr); }
+    size_t size() const { return len; }
+
+    // hint the kernel that the file will be read front to back
+    void adviseSequential() const;
+
+};
+
+#endif //QS_MAPPEDFILE_H
@@ -0,0 +1,98 @@
+#ifndef QS_PATHPIPELINE_H
+#define QS_PATHPIPELINE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "BitMatrix.h"
+#include "CardinalityCounter.h"
+#include "CondensedClosure.h"
+#include "Relation.h"
+#include "VisitedSet.h"
+
+/*
+ * Push-based, batch-at-a-time evaluation of a concatenation into a CardinalityCounter. A scan emits a
+ * (source, source) pair per candidate source, every step expands the targets of its input pairs over
+ * one operand and pushes the (source, target) pairs it reaches downstream in batches of BATCH_SIZE,
+ * which stay in cache. The pairs of a source arrive consecutively, so every step drops the duplicate
+ * targets of a source with one reusable set and nothing in between is materialized. Operands are
+ * label selections (views of the index), condensed closures and relations built by pipeline breakers.
+ * The steps form a tree rooted at step 0: concatenations with a common prefix share the steps of that
+ * prefix, and every concatenation ends in a sink step that counts into a counter of its own.
+ */
+class PathPipeline {
+
+public:
+
+    struct Pair {
+        uint32_t source;
+        uint32_t target;
+    };
+
+    static constexpr size_t BATCH_SIZE = 4096;
+    static constexpr uint32_t NO_SINK = UINT32_MAX;
+
+    /*
+     * Operand of a step: a closure, one relation in BITS layout (expanded by OR-ing bit rows),
+     * or the union of relations in LISTS layout. A step feeds the steps in next (which come after it),
+     * a sink step also counts what it reaches into counter number sink.
+     */
+    struct Step {
+        std::vector<std::shared_ptr<Relation>> relations;
+        std::shared_ptr<CondensedClosure> closure;
+
+        std::vector<uint32_t> next;
+        uint32_t sink = NO_SINK;
+
+        bool isBits() const {
+            return !closure && relations.size() == 1 && relations[0]->getLayout() == Relation::Layout::BITS;
+        }
+    };
+
+private:
+
+    static constexpr uint32_t NO_SOURCE = UINT32_MAX;
+
+    struct State {
+        uint32_t source = NO_SOURCE; // source of the pairs seen last
+        VisitedSet seen;             // targets (components for a closure) of that source
+        std::vector<Pair> out;       // pending output
+        std::vector<uint32_t> row;   // sink: targets of that source
+        bool bits = false;           // the operand is expanded by OR-ing bit rows
+        BitMatrix::Words acc;        // BITS: targets of that source
+        bool any = false;
+    };
+
+    const std::vector<Step> &steps;
+    uint32_t noVertices;
+    std::vector<State> states;
+
+    std::vector<CardinalityCounter> counters; // per sink
+
+    void push(size_t k, const Pair *pairs, size_t n);
+    void emit(size_t k, uint32_t source, uint32_t target);
+    void flush(size_t k);
+    void endSource(size_t k);
+
+public:
+
+    // counters: one empty counter per sink
+    PathPipeline(const std::vector<Step> &steps, uint32_t noVertices, std::vector<CardinalityCounter> counters);
+
+    // a single concatenation: every step feeds the following one, the last one is sink 0
+    static void chain(std::vector<Step> &steps);
+
+    /*
+     * Evaluate the path from some sources (ascending) and count the answer. The sources must be
+     * disjoint from those of earlier runs of this pipeline.
+     */
+    void run(ArrayView<uint32_t> sources);
+
+    const CardinalityCounter &getCounter(uint32_t sink) const { return counters[sink]; }
+
+    // the vertices with at least one target over the operand of a first step, ascending
+    static std::vector<uint32_t> sourcesOf(const Step &step, uint32_t noVertices);
+
+};
+
+#endif //QS_PATHPIPELINE_H
@@ -0,0 +1,60 @@
+#ifndef QS_PATHSAMPLER_H
+#define QS_PATHSAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Estimator.h"
+#include "Query.h"
+#include "SimpleGraph.h"
+#include "VisitedSet.h"
+
+/*
+ * Estimates a path query from a sample of its answer: BFS probes follow the whole path (unions and
+ * closures included) from a sample of the sources of its first entry, and the reversed path from a sample
+ * of the targets of its last entry. The distinct vertices a probe reaches are exactly what the evaluator
+ * would count for its start vertex, so the probes scale up to noOut and noPaths (forward) and to noIn
+ * (backward). A bound endpoint is a single probe and gives the exact answer.
+ * The budget of an estimate is a number of edge visits rather than a time, and the sample is drawn from a
+ * generator seeded the same for every estimate, so a query always gets the same estimate for a given seed.
+ */
+class PathSampler {
+
+    std::shared_ptr<SimpleGraph> graph;
+    uint64_t budget;
+    uint64_t seed;
+
+    // scratch of one probe, reused by the next probe on the same thread
+    struct Probe {
+        VisitedSet visited;
+        std::vector<uint32_t> frontier, next;
+        uint64_t work = 0; // edges visited
+    };
+
+    // the outcome of the probes from one end
+    struct Sample {
+        uint64_t noStarts = 0;   // vertices probes may start from
+        uint64_t noProbes = 0;
+        uint64_t noReaching = 0; // probes that reached at least one vertex
+        uint64_t noReached = 0;  // vertices reached, over all probes
+    };
+
+    bool follow(uint32_t start, const std::vector<PathEntry> &path, uint64_t limit, Probe &p) const;
+    bool sample(const std::vector<PathEntry> &path, uint64_t limit, Sample &s) const;
+
+public:
+
+    static constexpr uint64_t DEFAULT_BUDGET = 1u << 16;
+
+    PathSampler(std::shared_ptr<SimpleGraph> &g, uint64_t budget, uint64_t seed) : graph(g), budget(budget), seed(seed) {}
+
+    /*
+     * Estimate a query within the budget. Returns false if not even one probe per end fit, the
+     * estimate is then left to other means.
+     */
+    bool estimate(const Triple &q, cardStat &out) const;
+
+};
+
+#endif //QS_PATHSAMPLER_H
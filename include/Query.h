@@ -84,6 +84,23 @@ struct Triple {
         appendTo(out);
         return out.str();
     }
+
+    /*
+     * The same query read backwards: endpoints swapped, path entries in reverse order with every direction flipped.
+     * It produces the inverted answer (all (t, s) for (s, t) in the answer of this query).
+     */
+    Triple reversed() const {
+        Triple out;
+        out.src = trg;
+        out.trg = src;
+        out.path.assign(path.rbegin(), path.rend());
+        for (auto &entry : out.path) {
+            for (auto &labelDir : entry.labels) {
+                labelDir.reverse = !labelDir.reverse;
+            }
+        }
+        return out;
+    }
 };
 
 
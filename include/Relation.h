@@ -0,0 +1,227 @@
+#ifndef QS_RELATION_H
+#define QS_RELATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AdjacencyIndex.h"
+#include "BitMatrix.h"
+
+/*
+ * Intermediate answer of a query: distinct (source, target) pairs over the vertices of the graph.
+ * Only the sources with at least one target are stored (ascending), so a relation costs memory in
+ * proportion to its size, not to the number of vertices. The rows are kept in one of two layouts,
+ * picked from the observed size when the relation is built:
+ *  - LISTS: a sorted target list per source. The lists live in append-only arenas (or in the graph
+ *    index for a label selection) and are never copied, rows with equal targets may share one list
+ *  - BITS: one bitset over the vertices per source, when that is smaller than listing every pair;
+ *    joins with such a relation on the right run as a boolean matrix product
+ * A relation is immutable once built and may be read by several threads.
+ */
+class Relation {
+
+public:
+
+    enum class Layout { LISTS, BITS };
+
+    static constexpr size_t NO_ROW = SIZE_MAX;
+
+    /*
+     * Append-only storage for target lists. Chunks grow geometrically up to MAX_CHUNK entries and are
+     * never moved, so rows can point into them while more lists are appended.
+     */
+    class Arena {
+
+        static constexpr size_t FIRST_CHUNK = 1 << 12;
+        static constexpr size_t MAX_CHUNK = 1 << 20;
+
+        std::vector<std::unique_ptr<uint32_t[]>> chunks;
+        size_t chunkSize = 0;
+        size_t used = 0;
+        size_t noBytes = 0;
+
+    public:
+
+        template<typename It>
+        ArrayView<uint32_t> append(It begin, It end) {
+            auto n = (size_t) (end - begin);
+            if (chunkSize - used < n) {
+                chunkSize = std::max(n, chunks.empty() ? FIRST_CHUNK : std::min(MAX_CHUNK, chunkSize * 2));
+                chunks.emplace_back(new uint32_t[chunkSize]);
+                noBytes += chunkSize * sizeof(uint32_t);
+                used = 0;
+            }
+            uint32_t *out = chunks.back().get() + used;
+            std::copy(begin, end, out);
+            used += n;
+            return {out, n};
+        }
+
+        size_t getNoBytes() const { return noBytes; }
+
+    };
+
+    /*
+     * Collects the rows of a relation from parallel blocks without locking. Every block writes its rows
+     * (ascending sources, following the sources of the previous block) into its own part through a
+     * Writer; the part order is the row order of the relation.
+     */
+    class Builder {
+
+        struct Part {
+            std::vector<uint32_t> sources;
+            std::vector<ArrayView<uint32_t>> rows;
+        };
+
+        uint32_t noVertices;
+        std::vector<Part> parts;
+
+        std::mutex lock;
+        std::vector<std::unique_ptr<Arena>> arenas; // not in use by a writer
+
+    public:
+
+        class Writer {
+
+            Builder &builder;
+            Part &part;
+            std::unique_ptr<Arena> arena;
+
+        public:
+
+            Writer(Builder &builder, size_t part);
+            ~Writer();
+
+            Writer(const Writer &) = delete;
+            Writer &operator=(const Writer &) = delete;
+
+            // store a list (distinct and ascending) without adding a row, e.g. to share it between rows
+            template<typename It>
+            ArrayView<uint32_t> store(It begin, It end) { return arena->append(begin, end); }
+
+            // add a row with stored targets, an empty row is skipped
+            void add(uint32_t source, ArrayView<uint32_t> stored) {
+                if (stored.empty()) return;
+                part.sources.push_back(source);
+                part.rows.push_back(stored);
+            }
+
+            template<typename It>
+            void add(uint32_t source, It begin, It end) {
+                if (begin != end) add(source, store(begin, end));
+            }
+
+        };
+
+        Builder(uint32_t noVertices, size_t noParts) : noVertices(noVertices), parts(noParts) {}
+
+        // the relation, in the layout that takes less memory; all writers must be gone
+        std::shared_ptr<Relation> finish();
+
+    };
+
+private:
+
+    // rows per vertex above which find() uses a lookup array over all vertices instead of binary search
+    static constexpr uint32_t LOOKUP_RATIO = 16;
+
+    uint32_t noVertices;
+    Layout layout = Layout::LISTS;
+    uint64_t noPairs = 0;
+
+    ArrayView<uint32_t> sourceView;
+
+    // LISTS, a view of an index: row i is indexTargets[offsets[i], offsets[i + 1])
+    ArrayView<uint64_t> offsetView;
+    const uint32_t *indexTargets = nullptr;
+
+    // LISTS, built: row i is rows[i]
+    std::vector<ArrayView<uint32_t>> rows;
+    std::vector<std::unique_ptr<Arena>> arenas; // the storage of the rows
+
+    std::vector<uint32_t> sourcesData; // behind sourceView unless the relation is a view of an index
+
+    // BITS: row i is bits.row(i)
+    BitMatrix bits;
+
+    // vertex -> row, built on the first find() of a relation with many rows
+    mutable std::once_flag lookupOnce;
+    mutable std::atomic<bool> hasLookup {false};
+    mutable std::vector<uint32_t> rowOf;
+
+    size_t findSlow(uint32_t vertex) const;
+
+public:
+
+    explicit Relation(uint32_t noVertices) : noVertices(noVertices) {}
+
+    Relation(const Relation &) = delete;
+    Relation &operator=(const Relation &) = delete;
+
+    /*
+     * The edges of one label of an index, without copying them.
+     * The index must outlive the relation.
+     */
+    static std::shared_ptr<Relation> fromIndex(const AdjacencyIndex &index, uint32_t label, uint32_t noVertices);
+
+    /*
+     * A relation in BITS layout with zeroed rows for the given sources, to be filled with mutableBits().
+     * noPairs must match the number of bits that will be set.
+     */
+    static std::shared_ptr<Relation> withBitRows(uint32_t noVertices, std::vector<uint32_t> &&sources, uint64_t noPairs);
+
+    // whether bit rows take less memory than listing every pair of a relation of this size
+    static bool prefersBits(uint32_t noVertices, uint64_t noRows, uint64_t noPairs) {
+        uint64_t bitBytes = noRows * BitMatrix::strideFor(noVertices) * sizeof(uint64_t);
+        uint64_t listBytes = noPairs * sizeof(uint32_t) + noRows * sizeof(ArrayView<uint32_t>);
+        return noRows > 0 && bitBytes < listBytes;
+    }
+
+    // the relation itself if it is in LISTS layout, otherwise a converted copy
+    static std::shared_ptr<Relation> asLists(const std::shared_ptr<Relation> &r);
+
+    uint32_t getNoVertices() const { return noVertices; }
+    uint64_t getNoPairs() const { return noPairs; }
+    size_t getNoRows() const { return sourceView.size(); }
+    Layout getLayout() const { return layout; }
+
+    // memory owned by the relation (a view of an index owns nothing but its lookup array)
+    uint64_t getNoBytes() const;
+
+    // build the lookup array now if find() would build it, so that getNoBytes() does not grow later
+    void buildLookup() const;
+
+    ArrayView<uint32_t> sources() const { return sourceView; }
+    uint32_t sourceAt(size_t i) const { return sourceView[i]; }
+
+    // LISTS only: the targets of row i
+    ArrayView<uint32_t> targetsAt(size_t i) const {
+        if (indexTargets == nullptr) return rows[i];
+        return {indexTargets + offsetView[i], offsetView[i + 1] - offsetView[i]};
+    }
+
+    // BITS only: the bitset of row i, getStride() words
+    const uint64_t *bitsAt(size_t i) const { return bits.row(i); }
+    uint64_t *mutableBits(size_t i) { return bits.row(i); }
+    size_t getStride() const { return bits.getStride(); }
+
+    // the targets of row i, ascending, in either layout (a BITS row is decoded into scratch)
+    ArrayView<uint32_t> row(size_t i, std::vector<uint32_t> &scratch) const {
+        if (layout == Layout::LISTS) return targetsAt(i);
+        scratch.clear();
+        BitMatrix::appendBits(bits.row(i), bits.getStride(), scratch);
+        return scratch;
+    }
+
+    // the row of a vertex, NO_ROW if it has no targets
+    size_t find(uint32_t vertex) const {
+        if (hasLookup.load(std::memory_order_acquire)) return rowOf[vertex] == UINT32_MAX ? NO_ROW : rowOf[vertex];
+        return findSlow(vertex);
+    }
+
+};
+
+#endif //QS_RELATION_H
@@ -3,28 +3,18 @@
 
 #include "Estimator.h"
 #include "SimpleGraph.h"
-#include <set>
+#include "StatisticsCatalog.h"
+#include "LabelPairSynopsis.h"
+#include "PathSampler.h"
 
 class SimpleEstimator : public Estimator {
 
     std::shared_ptr<SimpleGraph> graph;
 
 private:
-    uint32_t numSrc = 0;
-    uint32_t numTrg = 0;
-    uint32_t numLabels = 0;
-    uint32_t numTuples = 0;
-    uint32_t numEdges = 0;
-
-    cardStat unionPairwise(cardStat src, cardStat trg);
-
-    std::vector<std::vector<uint32_t>> labels;
-
-    struct labelInfo{
-        std::set<uint32_t> outLabelNode;
-        uint32_t numLabelPath = 0;
-        std::set<uint32_t> inLabelNode;
-    };
+    StatisticsCatalog catalog;
+    LabelPairSynopsis synopsis;
+    std::unique_ptr<PathSampler> sampler; // estimates long paths and closures, if sampling is on
 
 public:
     explicit SimpleEstimator(std::shared_ptr<SimpleGraph> &g);
@@ -33,11 +23,18 @@ public:
     void prepare() override ;
     cardStat estimate(Triple &q) override ;
 
+    const StatisticsCatalog &getCatalog() const { return catalog; }
+    const LabelPairSynopsis &getSynopsis() const { return synopsis; }
+
+    // estimate paths of more than two entries and paths with a closure by sampling; a budget of 0 turns it off
+    void setSampling(uint64_t budget, uint64_t seed);
+
     void estimateOnNodes(uint32_t src, cardStat &estimate, uint32_t trg);
 
 //    cardStat singleOperation(uint32_t reverse, bool kleene);
 
     cardStat concatenation(cardStat src, cardStat trg);
+    cardStat concatenation(cardStat src, cardStat trg, const PathEntry &last, const PathEntry &first);
 
     cardStat Union(std::vector<LabelDir> labels, bool kleene);
 
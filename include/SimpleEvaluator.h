@@ -7,13 +7,31 @@
 #include "Query.h"
 #include "Evaluator.h"
 #include "Graph.h"
+#include "VisitedSet.h"
+#include "JoinPlanner.h"
+#include "ThreadPool.h"
+#include "Relation.h"
+#include "PathPipeline.h"
+#include "SubplanCache.h"
+
+class CardinalityCounter;
+class CondensedClosure;
+
+enum class JoinOrder {
+    TEXTUAL, // left-deep, in the order of the query
+    PLANNED  // cheapest order according to the attached estimator
+};
 
 class SimpleEvaluator : public Evaluator {
 
     std::shared_ptr<SimpleGraph> graph;
     std::shared_ptr<SimpleEstimator> est;
-    std::unordered_map<std::string, std::shared_ptr<SimpleGraph>> joinCache;
-    std::unordered_map<std::string, std::shared_ptr<SimpleGraph>> unionCache;
+    SubplanCache cache; // unions, closures and joined sub-paths, across queries
+
+    JoinOrder joinOrder = JoinOrder::PLANNED;
+    bool approximate = false; // count distinct targets with a sketch (see CardinalityCounter)
+
+    std::shared_ptr<ThreadPool> pool; // shared by all operators of this evaluator
 
 public:
 
@@ -21,19 +39,47 @@ public:
     ~SimpleEvaluator() = default;
 
     void prepare() override ;
-    cardStat evaluate(Triple &query) override ;
+    cardStat evaluate(const Triple &query) override ;
+    std::vector<cardStat> evaluateBatch(const std::vector<Triple> &queries);
 
     void attachEstimator(std::shared_ptr<SimpleEstimator> &e);
+    void setJoinOrder(JoinOrder order);
+    void setNoThreads(uint32_t noThreads);
+    void setCacheBudget(uint64_t bytes);
+    void setApproximate(bool on);
+    // relative standard error of noIn in the answers, 0 if they are exact
+    double getRelativeError() const;
+    SubplanCache::Stats getCacheStats() const { return cache.getStats(); }
+
+    JoinPlan planJoins(const std::vector<PathEntry> &path);
+    std::shared_ptr<Relation> evaluateConcat(const std::vector<PathEntry> &path);
+    std::shared_ptr<Relation> evaluatePlan(const std::vector<PathEntry> &path, const JoinPlan &plan, uint32_t i, uint32_t j);
+    std::shared_ptr<Relation> evaluateUnionKleene(const PathEntry &pe);
+
+    std::vector<uint32_t> evaluateFrom(uint32_t source, const std::vector<PathEntry> &path);
+    void expandFrontier(const std::vector<uint32_t> &frontier, const PathEntry &pe, VisitedSet &visited, std::vector<uint32_t> &next);
+    void expandEntry(const std::vector<uint32_t> &frontier, const PathEntry &pe, VisitedSet &visited, std::vector<uint32_t> &next);
+
+    // meet-in-the-middle evaluation of a concatenation
+    uint32_t chooseMiddle(const std::vector<PathEntry> &path);
+    std::vector<std::vector<uint64_t>> matchVertices(const std::vector<PathEntry> &path);
+    void followMatches(uint32_t start, const std::vector<PathEntry> &path, uint32_t length,
+                       const std::vector<std::vector<uint64_t>> &on, bool backward, VisitedSet &visited, std::vector<uint32_t> &frontier, std::vector<uint32_t> &next);
+    void countBidirectional(const std::vector<PathEntry> &path, uint32_t middle, CardinalityCounter &counter);
 
-    std::shared_ptr<SimpleGraph> evaluateConcat(std::vector<PathEntry> &path, std::string query);
-    std::shared_ptr<SimpleGraph> evaluateUnionKleene(PathEntry &pe);
+    static std::shared_ptr<Relation> selectLabel(uint32_t projectLabel, bool inverse, std::shared_ptr<SimpleGraph> &in);
+    std::shared_ptr<Relation> join(std::shared_ptr<Relation> &left, std::shared_ptr<Relation> &right);
+    std::shared_ptr<Relation> transitiveClosure(std::shared_ptr<Relation> &base);
+    static std::shared_ptr<Relation> unionDistinct(std::shared_ptr<Relation> &left, std::shared_ptr<Relation> &right);
+    static cardStat computeStats(std::shared_ptr<Relation> &r);
 
-    static std::shared_ptr<SimpleGraph> selectLabel(uint32_t projectLabel, uint32_t outLabel, bool inverse, std::shared_ptr<SimpleGraph> &in);
-    static std::shared_ptr<SimpleGraph> join(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right);
-    static std::shared_ptr<SimpleGraph> transitiveClosure( std::shared_ptr<SimpleGraph> &base);
-    static std::shared_ptr<SimpleGraph> unionDistinct(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right);
-    static uint32_t unionDistinctTC(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right);
-    static cardStat computeStats(std::shared_ptr<SimpleGraph> &g);
+    // counting-only sinks for the last operator of a plan
+    static void countGraph(std::shared_ptr<Relation> &r, CardinalityCounter &counter);
+    std::shared_ptr<CondensedClosure> closureOf(const PathEntry &pe);
+    PathPipeline::Step pipelineStep(const PathEntry &pe);
+    void countPipelined(const std::vector<PathEntry> &path, const JoinPlan &plan, CardinalityCounter &counter);
+    void countSteps(const std::vector<PathPipeline::Step> &steps, const std::vector<CardinalityCounter *> &counters);
+    void countLabels(const PathEntry &pe, CardinalityCounter &counter);
 
 };
 
@@ -8,15 +8,22 @@
 #include <regex>
 #include <fstream>
 #include <map>
+#include <memory>
 #include "Graph.h"
+#include "AdjacencyIndex.h"
+
+class GraphParser;
+class MappedFile;
 
 class SimpleGraph : public Graph {
 public:
 //    std::vector<std::vector<std::pair<uint32_t,uint32_t>>> adj;
 //    std::vector<std::vector<std::pair<uint32_t,uint32_t>>> reverse_adj; // vertex adjacency list
 
-    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> PSO;
-    std::unordered_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> POS;
+    AdjacencyIndex PSO; // label -> subject -> objects
+    AdjacencyIndex POS; // label -> object -> subjects
+
+    std::shared_ptr<MappedFile> snapshot; // backs PSO/POS when the graph was read from a snapshot
 
     std::vector<std::vector<uint32_t>> SO;
 
@@ -26,6 +33,9 @@ protected:
     uint32_t V;
     uint32_t L;
 
+    using EdgeBuckets = std::vector<AdjacencyIndex::EdgeBucket>;
+    void parseEdges(GraphParser &parser, EdgeBuckets &pso) const;
+
 public:
 
     SimpleGraph() : V(0), L(0) {};
@@ -40,8 +50,10 @@ public:
 
     void addEdge(uint32_t from, uint32_t to, uint32_t edgeLabel) override ;
     void readFromContiguousFile(const std::string &fileName) override ;
+    void readFromContiguousFile(const std::string &fileName, uint32_t noThreads);
 
     bool edgeExists(uint32_t from, uint32_t to, uint32_t edgeLabel);
+    void setEdges(uint32_t from, std::vector<uint32_t> &&targets);
 
     void setNoVertices(uint32_t n);
     void setNoLabels(uint32_t noLabels);
@@ -0,0 +1,103 @@
+#ifndef QS_STATISTICSCATALOG_H
+#define QS_STATISTICSCATALOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AdjacencyIndex.h"
+#include "HyperLogLog.h"
+#include "SimpleGraph.h"
+
+/*
+ * Per-label statistics of a graph, read straight off the PSO/POS indexes: their rows are distinct, so
+ * the number of vertices of a label in PSO (POS) is its number of distinct sources (targets), the number
+ * of targets its number of distinct pairs, and the length of a row a vertex's out-degree (in-degree).
+ * Degrees are kept as log2 histograms: bucket b counts the vertices with degree in [2^b, 2^(b + 1)).
+ * The sources, the targets and the pairs of every label are also kept in small HyperLogLog sketches, so the
+ * distinct vertices and pairs of several labels together (of a union) can be counted by merging theirs. The
+ * pairs as (target, source), which only a union of labels in both directions needs, are sketched on first use.
+ * Everything lives in flat arrays indexed by label, a label the graph does not have reads as empty.
+ */
+class StatisticsCatalog {
+
+public:
+
+    static constexpr uint32_t NO_BUCKETS = 32;
+    static constexpr size_t MIN_PARALLEL_VERTICES = 1u << 18; // (label, vertex) entries of both indexes
+    static constexpr uint8_t SKETCH_PRECISION = 10; // 1 KiB per label and direction, 3% standard error
+    static constexpr uint64_t MAX_TASK_EDGES = 1u << 18; // larger labels are split into vertex ranges
+
+    struct LabelStats {
+        uint32_t noSources = 0;    // distinct vertices with an outgoing edge of the label
+        uint32_t noTargets = 0;    // distinct vertices with an incoming edge of the label
+        uint64_t noPairs = 0;      // distinct (source, target) pairs
+        uint32_t maxOutDegree = 0;
+        uint32_t maxInDegree = 0;
+    };
+
+private:
+
+    std::vector<LabelStats> labels;
+    std::vector<uint32_t> histograms; // per label: NO_BUCKETS out-degree buckets, then NO_BUCKETS in-degree buckets
+    std::vector<HyperLogLog> sketches;     // per label: its sources, then its targets
+    std::vector<HyperLogLog> pairSketches; // per label: its (source, target) pairs
+
+    // per label: its (target, source) pairs, empty until first asked for
+    const SimpleGraph *graph = nullptr;
+    mutable std::vector<HyperLogLog> reversedPairSketches;
+    mutable std::unique_ptr<std::once_flag[]> reversedPairsBuilt;
+    mutable std::atomic<uint64_t> reversedPairBytes {0};
+
+    uint32_t noVertices = 0;
+    uint32_t noSources = 0; // distinct over all labels
+    uint32_t noTargets = 0;
+    uint64_t noPairs = 0;
+
+public:
+
+    /*
+     * Collect the statistics in one pass over the vertex arrays of both indexes, every (label, direction)
+     * a task of its own, or several over ranges of its vertices if it has many edges. The graph must
+     * outlive the catalog. 0 threads means one per hardware thread.
+     */
+    void build(const SimpleGraph &g, uint32_t noThreads = 0);
+
+    uint32_t getNoLabels() const { return (uint32_t) labels.size(); }
+    uint32_t getNoVertices() const { return noVertices; }
+    uint32_t getNoSources() const { return noSources; }
+    uint32_t getNoTargets() const { return noTargets; }
+    uint64_t getNoPairs() const { return noPairs; }
+
+    const LabelStats &label(uint32_t label) const {
+        static const LabelStats none;
+        return label < labels.size() ? labels[label] : none;
+    }
+
+    // log2 histogram of the out-degrees (reverse: in-degrees) of a label, empty for an unknown label
+    ArrayView<uint32_t> degrees(uint32_t label, bool reverse) const {
+        if(label >= labels.size()) return {};
+        return {histograms.data() + (2 * label + reverse) * NO_BUCKETS, NO_BUCKETS};
+    }
+
+    // sketch of the sources (reverse: targets) of a label, empty for an unknown label
+    const HyperLogLog &sketch(uint32_t label, bool reverse) const {
+        static const HyperLogLog none(SKETCH_PRECISION);
+        return label < labels.size() ? sketches[2 * label + reverse] : none;
+    }
+
+    // sketch of the pairs of a label, as (source, target) or (reverse) as (target, source)
+    const HyperLogLog &pairSketch(uint32_t label, bool reverse) const;
+
+    uint64_t getNoBytes() const {
+        uint64_t noBytes = labels.capacity() * sizeof(LabelStats) + histograms.capacity() * sizeof(uint32_t);
+        for(const auto &sketch : sketches) noBytes += sizeof(HyperLogLog) + sketch.getNoBytes();
+        for(const auto &sketch : pairSketches) noBytes += sizeof(HyperLogLog) + sketch.getNoBytes();
+        noBytes += reversedPairSketches.capacity() * sizeof(HyperLogLog) + reversedPairBytes.load();
+        return noBytes;
+    }
+
+};
+
+#endif //QS_STATISTICSCATALOG_H
@@ -0,0 +1,102 @@
+#ifndef QS_SUBPLANCACHE_H
+#define QS_SUBPLANCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "CondensedClosure.h"
+#include "Query.h"
+#include "Relation.h"
+
+/*
+ * Results of sub-plans (unions, closures and joined sub-paths), kept across queries. A sub-plan is keyed
+ * by its normalized entries: the distinct labels of an entry in ascending order, each with its direction,
+ * and the Kleene flag. So (1>|2<) and (2<|1>) share a result, 1> and 1< do not. A closure is kept either
+ * materialized (a relation) or condensed (a CondensedClosure), under different keys.
+ * At most a byte budget of results is kept. Eviction is a cost-aware LRU (GreedyDual-Size): the
+ * priority of an entry is the clock at its last use plus its compute time per byte, the entry with the
+ * lowest priority is evicted first and advances the clock to its priority. Large, cheap and long unused
+ * results thus go before small, expensive and recent ones.
+ * The cache may be used by concurrent queries. Two queries missing the same sub-plan at once both compute
+ * it, the second insert replaces the first.
+ */
+class SubplanCache {
+
+public:
+
+    struct Key {
+        std::vector<uint32_t> words; // per entry: kleene << 31 | #labels, then (label << 1 | reverse) ascending
+        uint64_t hash = 0;
+
+        bool operator==(const Key &other) const { return hash == other.hash && words == other.words; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return (size_t) key.hash; }
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t noBytes = 0;   // held by the cached relations and closures
+        uint64_t noEntries = 0;
+    };
+
+    static constexpr uint64_t DEFAULT_BUDGET = 256ULL << 20;
+
+private:
+
+    struct Entry {
+        std::shared_ptr<Relation> relation;         // either a relation
+        std::shared_ptr<CondensedClosure> closure;  // or a condensed closure
+        uint64_t noBytes;
+        double costPerByte;
+        double priority;
+    };
+
+    uint64_t budget;
+    double clock = 0;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::set<std::pair<double, const Key *>> byPriority; // keys of a node-based map do not move
+
+    Stats stats;
+    mutable std::mutex lock; // guards all of the above
+
+    void erase(std::unordered_map<Key, Entry, KeyHash>::iterator it);
+    void evictDownTo(uint64_t noBytes);
+    const Entry *lookup(const Key &key);
+    void keep(const Key &key, Entry entry, double cost);
+
+public:
+
+    explicit SubplanCache(uint64_t budget = DEFAULT_BUDGET) : budget(budget) {}
+
+    // the key of the sub-path [first, last)
+    static Key keyOf(const PathEntry *first, const PathEntry *last);
+
+    // the key of the condensed closure of a Kleene entry (not that of its materialized closure)
+    static Key condensedKeyOf(const PathEntry &pe);
+
+    // the cached result, or nullptr (counted as a miss)
+    std::shared_ptr<Relation> find(const Key &key);
+    std::shared_ptr<CondensedClosure> findClosure(const Key &key);
+
+    /*
+     * Keep a result computed in cost nanoseconds, evicting others to stay within the budget.
+     * A result larger than the whole budget is not kept.
+     */
+    void insert(const Key &key, std::shared_ptr<Relation> relation, double cost);
+    void insert(const Key &key, std::shared_ptr<CondensedClosure> closure, double cost);
+
+    // a smaller budget evicts right away
+    void setBudget(uint64_t bytes);
+
+    Stats getStats() const;
+
+};
+
+#endif //QS_SUBPLANCACHE_H
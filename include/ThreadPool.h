@@ -0,0 +1,146 @@
+#ifndef QS_THREADPOOL_H
+#define QS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads with one task deque per worker. A worker takes tasks from the back of its
+ * own deque and, once that is empty, steals from the front of the others, so a worker that got the
+ * expensive part of a range is helped by the ones that are done. The calling thread of parallelFor
+ * works along on the chunks of its own range until it is finished, never on those of another caller,
+ * so one caller's range does not wait on the work of the others.
+ */
+class ThreadPool {
+
+    struct Task {
+        const void *job; // the parallelFor call the task is a chunk of
+        std::function<void()> run;
+    };
+
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues; // queue 0 belongs to the calling threads
+    std::vector<std::thread> workers;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<uint64_t> noQueued {0};
+    bool stopping = false;
+
+    void push(size_t queue, const void *job, std::function<void()> task);
+    bool tryPop(size_t self, std::function<void()> &task);
+    bool tryPopOf(const void *job, std::function<void()> &task);
+    void work(size_t self);
+
+public:
+
+    // 0 means one thread per hardware thread (the calling thread counts as one)
+    explicit ThreadPool(uint32_t noThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    uint32_t getNoThreads() const { return (uint32_t) queues.size(); }
+
+    /*
+     * Run fn(begin, end) over [first, last) in chunks of (at most) grain, return when all chunks are done.
+     * Rethrows the first exception thrown by a chunk.
+     */
+    template<typename F>
+    void parallelFor(uint64_t first, uint64_t last, uint64_t grain, F fn);
+
+    /*
+     * parallelFor where every chunk runs fn(partial, begin, end) on a partial result (e.g. a counter): one
+     * made by make() or left by an earlier chunk on any thread. Returns the partials made, at most one per
+     * chunk running at once, for the caller to merge.
+     */
+    template<typename Make, typename F>
+    auto parallelForPartials(uint64_t first, uint64_t last, uint64_t grain, Make make, F fn)
+            -> std::vector<decltype(make())>;
+
+};
+
+template<typename F>
+void ThreadPool::parallelFor(uint64_t first, uint64_t last, uint64_t grain, F fn) {
+    if(first >= last) return;
+    grain = std::max<uint64_t>(grain, 1);
+    uint64_t noChunks = (last - first + grain - 1) / grain;
+    if(queues.size() == 1 || noChunks == 1) {
+        fn(first, last);
+        return;
+    }
+
+    struct Job {
+        std::atomic<uint64_t> remaining;
+        std::mutex lock;
+        std::condition_variable done;
+        std::exception_ptr error;
+    } job;
+    job.remaining = noChunks;
+
+    // contiguous runs of chunks per queue, so neighbouring sources usually stay on one thread
+    for(uint64_t chunk = 0; chunk < noChunks; chunk++) {
+        uint64_t begin = first + chunk * grain;
+        uint64_t end = std::min(last, begin + grain);
+        push(chunk * queues.size() / noChunks, &job, [&job, &fn, begin, end]() {
+            std::exception_ptr error;
+            try {
+                fn(begin, end);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            // under the lock: the caller may destroy the job as soon as it sees the last chunk finish
+            std::lock_guard<std::mutex> guard(job.lock);
+            if(error && !job.error) job.error = error;
+            if(--job.remaining == 0) job.done.notify_all();
+        });
+    }
+
+    // help out with the chunks of this job still queued
+    std::function<void()> task;
+    while(job.remaining > 0 && tryPopOf(&job, task)) task();
+
+    std::unique_lock<std::mutex> guard(job.lock);
+    job.done.wait(guard, [&job]() { return job.remaining == 0; });
+    if(job.error) std::rethrow_exception(job.error);
+}
+
+template<typename Make, typename F>
+auto ThreadPool::parallelForPartials(uint64_t first, uint64_t last, uint64_t grain, Make make, F fn)
+        -> std::vector<decltype(make())> {
+    std::mutex lock;
+    std::vector<decltype(make())> partials;
+    parallelFor(first, last, grain, [&](uint64_t begin, uint64_t end) {
+        decltype(make()) partial;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if(!partials.empty()) {
+                partial = std::move(partials.back());
+                partials.pop_back();
+            }
+        }
+        if(!partial) partial = make();
+
+        fn(*partial, begin, end);
+
+        std::lock_guard<std::mutex> guard(lock);
+        partials.push_back(std::move(partial));
+    });
+    return partials;
+}
+
+#endif //QS_THREADPOOL_H
@@ -0,0 +1,44 @@
+#ifndef QS_VISITEDSET_H
+#define QS_VISITEDSET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Set of vertices backed by an epoch-stamped array: clear() is O(1), so one instance can be reused
+ * by many traversals and each traversal only pays for the vertices it touches.
+ */
+class VisitedSet {
+
+    std::vector<uint32_t> stamps;
+    uint32_t epoch = 0;
+
+public:
+
+    // empty the set and make room for vertex ids < n
+    void clear(uint32_t n) {
+        if (stamps.size() < n) {
+            stamps.assign(n, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // returns true if v was not in the set yet
+    bool insert(uint32_t v) {
+        if (stamps[v] == epoch) return false;
+        stamps[v] = epoch;
+        return true;
+    }
+
+    bool contains(uint32_t v) const {
+        return stamps[v] == epoch;
+    }
+
+};
+
+#endif //QS_VISITEDSET_H
@@ -0,0 +1,192 @@
+#include "AdjacencyIndex.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+    // run fn(label) for every label, labels handed out to the threads one at a time
+    template<typename F>
+    void forEachLabel(uint32_t noLabels, uint32_t noThreads, F fn) {
+        noThreads = std::max(1u, std::min(noThreads, noLabels));
+        if(noThreads == 1) {
+            for(uint32_t label = 0; label < noLabels; label++) fn(label);
+            return;
+        }
+
+        std::atomic<uint32_t> next {0};
+        std::vector<std::thread> workers;
+        for(uint32_t i = 0; i < noThreads; i++) {
+            workers.emplace_back([&]() {
+                for(uint32_t label = next++; label < noLabels; label = next++) fn(label);
+            });
+        }
+        for(auto &w : workers) w.join();
+    }
+
+    /*
+     * LSD radix sort of the packed keys with 11-bit digits. Only the bits actually used by the vertex and
+     * the neighbour half of the keys are sorted on, so a graph with 1M vertices needs four passes.
+     */
+    void radixSort(AdjacencyIndex::EdgeBucket &keys) {
+        if(keys.size() < 256) {
+            std::sort(keys.begin(), keys.end());
+            return;
+        }
+
+        uint64_t used = 0;
+        for(auto key : keys) used |= key;
+
+        constexpr unsigned DIGIT_BITS = 11;
+        std::vector<unsigned> shifts;
+        for(unsigned half = 0; half < 64; half += 32) {
+            auto bits = (uint32_t) (used >> half);
+            for(unsigned shift = 0; shift < 32 && (bits >> shift) != 0; shift += DIGIT_BITS) {
+                shifts.push_back(half + shift);
+            }
+        }
+
+        std::vector<std::array<size_t, 1u << DIGIT_BITS>> histograms(shifts.size());
+        for(auto &h : histograms) h.fill(0);
+        for(auto key : keys) {
+            for(size_t d = 0; d < shifts.size(); d++) histograms[d][(key >> shifts[d]) & ((1u << DIGIT_BITS) - 1)]++;
+        }
+
+        AdjacencyIndex::EdgeBucket buffer(keys.size());
+        for(size_t d = 0; d < shifts.size(); d++) {
+            auto &h = histograms[d];
+            if(std::find(h.begin(), h.end(), keys.size()) != h.end()) continue; // all keys share the digit
+
+            size_t offset = 0;
+            for(auto &count : h) {
+                auto c = count;
+                count = offset;
+                offset += c;
+            }
+            auto shift = shifts[d];
+            for(auto key : keys) buffer[h[(key >> shift) & ((1u << DIGIT_BITS) - 1)]++] = key;
+            keys.swap(buffer);
+        }
+    }
+
+    // sort and deduplicate a bucket, returns the number of distinct vertices
+    uint64_t normalize(AdjacencyIndex::EdgeBucket &bucket) {
+        radixSort(bucket);
+        bucket.erase(std::unique(bucket.begin(), bucket.end()), bucket.end());
+
+        uint64_t noVertices = 0;
+        for(size_t i = 0; i < bucket.size(); i++) {
+            if(i == 0 || (bucket[i] >> 32) != (bucket[i - 1] >> 32)) noVertices++;
+        }
+        return noVertices;
+    }
+
+}
+
+/**
+ * Lay out the per-label offsets once the number of vertices and edges of every label is known.
+ */
+void AdjacencyIndex::allocate(const std::vector<uint64_t> &noVertices, const std::vector<uint64_t> &noEdges) {
+
+    labelOffsetsData.assign(noVertices.size() + 1, 0);
+    labelEdgeOffsets.assign(noVertices.size() + 1, 0);
+    for(size_t label = 0; label < noVertices.size(); label++) {
+        labelOffsetsData[label + 1] = labelOffsetsData[label] + noVertices[label];
+        labelEdgeOffsets[label + 1] = labelEdgeOffsets[label] + noEdges[label];
+    }
+
+    verticesData.assign(labelOffsetsData.back(), 0);
+    edgeOffsetsData.assign(labelOffsetsData.back() + 1, 0);
+    edgeOffsetsData.back() = labelEdgeOffsets.back();
+    targetsData.assign(labelEdgeOffsets.back(), 0);
+}
+
+/**
+ * Write one label's sorted, deduplicated pairs into the space reserved by allocate().
+ */
+void AdjacencyIndex::fill(uint32_t label, const EdgeBucket &bucket) {
+
+    uint64_t vertex = labelOffsetsData[label];
+    uint64_t edge = labelEdgeOffsets[label];
+
+    for(size_t i = 0; i < bucket.size(); i++) {
+        if(i == 0 || (bucket[i] >> 32) != (bucket[i - 1] >> 32)) {
+            verticesData[vertex] = (uint32_t) (bucket[i] >> 32);
+            edgeOffsetsData[vertex] = edge;
+            vertex++;
+        }
+        targetsData[edge++] = (uint32_t) bucket[i];
+    }
+}
+
+void AdjacencyIndex::publish() {
+    labelEdgeOffsets.clear();
+    labelEdgeOffsets.shrink_to_fit();
+
+    labelOffsets = labelOffsetsData;
+    vertices = verticesData;
+    edgeOffsets = edgeOffsetsData;
+    targets = targetsData;
+}
+
+void AdjacencyIndex::build(std::vector<EdgeBucket> &buckets, uint32_t noThreads) {
+
+    auto noLabels = (uint32_t) buckets.size();
+    std::vector<uint64_t> noVertices(noLabels), noEdges(noLabels);
+
+    forEachLabel(noLabels, noThreads, [&](uint32_t label) {
+        noVertices[label] = normalize(buckets[label]);
+        noEdges[label] = buckets[label].size();
+    });
+
+    allocate(noVertices, noEdges);
+
+    forEachLabel(noLabels, noThreads, [&](uint32_t label) {
+        fill(label, buckets[label]);
+        EdgeBucket().swap(buckets[label]);
+    });
+
+    publish();
+}
+
+void AdjacencyIndex::buildTransposed(const AdjacencyIndex &other, uint32_t noThreads) {
+
+    auto noLabels = other.getNoLabels();
+    std::vector<EdgeBucket> buckets(noLabels);
+
+    forEachLabel(noLabels, noThreads, [&](uint32_t label) {
+        auto &bucket = buckets[label];
+        bucket.reserve(other.getNoEdges(label));
+        auto sources = other.sources(label);
+        for(size_t i = 0; i < sources.size(); i++) {
+            for(auto target : other.neighboursAt(other.labelOffsets[label] + i)) {
+                bucket.push_back(edgeKey(target, sources[i]));
+            }
+        }
+    });
+
+    build(buckets, noThreads);
+}
+
+void AdjacencyIndex::attach(ArrayView<uint64_t> labelOffsets, ArrayView<uint32_t> vertices,
+                            ArrayView<uint64_t> edgeOffsets, ArrayView<uint32_t> targets) {
+
+    labelOffsetsData.clear();
+    verticesData.clear();
+    edgeOffsetsData.clear();
+    targetsData.clear();
+
+    this->labelOffsets = labelOffsets;
+    this->vertices = vertices;
+    this->edgeOffsets = edgeOffsets;
+    this->targets = targets;
+}
+
+ArrayView<uint32_t> AdjacencyIndex::neighbours(uint32_t label, uint32_t vertex) const {
+    auto src = sources(label);
+    auto it = std::lower_bound(src.begin(), src.end(), vertex);
+    if(it == src.end() || *it != vertex) return {};
+    return neighboursAt(labelOffsets[label] + (it - src.begin()));
+}
@@ -0,0 +1,131 @@
+#include "AutomatonEvaluator.h"
+#include "CardinalityCounter.h"
+#include <algorithm>
+
+PathAutomaton::PathAutomaton(const std::vector<PathEntry> &path) : transitions(path.size() + 1) {
+    for(uint32_t i = 0; i < path.size(); i++) {
+        for(auto labelDir : path[i].labels) {
+            transitions[i].push_back({labelDir, i + 1});
+            if(path[i].kleene) transitions[i + 1].push_back({labelDir, i + 1});
+        }
+    }
+}
+
+AutomatonEvaluator::AutomatonEvaluator(std::shared_ptr<SimpleGraph> &g) {
+    graph = g;
+    pool = std::make_shared<ThreadPool>();
+}
+
+/**
+ * Set the number of threads the start vertices are spread over.
+ * @param noThreads Number of threads, 0 means one per hardware thread.
+ */
+void AutomatonEvaluator::setNoThreads(uint32_t noThreads) {
+    pool = std::make_shared<ThreadPool>(noThreads);
+}
+
+void AutomatonEvaluator::prepare() {
+    // the automaton is built per query, the indexes of the graph are all the search needs
+}
+
+/**
+ * Explore the product graph from one start vertex (depth first, every (vertex, state) pair once).
+ * @param automaton Automaton of the path.
+ * @param start Start vertex, paired with the start state.
+ * @param s Scratch; receives the distinct vertices reached in the accepting state in s.reached.
+ */
+void AutomatonEvaluator::search(const PathAutomaton &automaton, uint32_t start, Search &s) {
+
+    auto noVertices = graph->getNoVertices();
+    s.visited.resize(automaton.getNoStates());
+    for(auto &visited : s.visited) visited.clear(noVertices);
+    s.stack.clear();
+    s.reached.clear();
+
+    s.visited[0].insert(start);
+    s.stack.emplace_back(start, 0);
+    while(!s.stack.empty()) {
+        auto [vertex, state] = s.stack.back();
+        s.stack.pop_back();
+
+        for(const auto &t : automaton.transitions[state]) {
+            const auto &index = t.labelDir.reverse ? graph->POS : graph->PSO;
+            auto &visited = s.visited[t.to];
+            for(auto target : index.neighbours(t.labelDir.label, vertex)) {
+                if(!visited.insert(target)) continue;
+                if(t.to == automaton.accepting()) s.reached.push_back(target);
+                if(!automaton.transitions[t.to].empty()) s.stack.emplace_back(target, t.to);
+            }
+        }
+    }
+}
+
+/**
+ * Count the answer of the searches from a set of start vertices. Blocks of start vertices are spread
+ * over the thread pool, every block counts into a partial counter (reused by the next block on any
+ * thread), the partial counters are merged at the end.
+ * @param automaton Automaton of the path.
+ * @param starts Distinct start vertices.
+ * @param counter Sink for the answer.
+ */
+void AutomatonEvaluator::countFrom(const PathAutomaton &automaton, const std::vector<uint32_t> &starts, CardinalityCounter &counter) {
+
+    auto partials = pool->parallelForPartials(0, starts.size(), 256, [&]() {
+        return std::make_unique<CardinalityCounter>(counter.emptyLike());
+    }, [&](CardinalityCounter &partial, uint64_t first, uint64_t last) {
+        thread_local Search s;
+        for(auto i = first; i < last; i++) {
+            search(automaton, starts[i], s);
+            partial.addSource(s.reached.begin(), s.reached.end());
+        }
+    });
+
+    for(auto &partial : partials) counter.merge(*partial);
+}
+
+/**
+ * Evaluate a path query. Produce a cardinality of the answer graph.
+ * A bound source is searched from alone, a bound target as well is then looked up among the vertices it
+ * reaches. A bound target (with a free source) is searched from with the automaton of the reversed path,
+ * every vertex reached is a source of the answer. Otherwise every vertex with an edge of the first path
+ * entry is a start vertex.
+ * @param query Query to evaluate.
+ * @return A cardinality statistics of the answer graph.
+ */
+cardStat AutomatonEvaluator::evaluate(const Triple &query) {
+
+    auto noVertices = graph->getNoVertices();
+
+    if(query.src == NO_IDENTIFIER && query.trg != NO_IDENTIFIER) {
+        auto reversed = query.reversed();
+        if(reversed.src >= noVertices) return cardStat {0, 0, 0};
+        Search s;
+        search(PathAutomaton(reversed.path), reversed.src, s);
+        auto n = (uint32_t) s.reached.size();
+        return cardStat {n, n, n ? 1u : 0u};
+    }
+
+    PathAutomaton automaton(query.path);
+
+    if(query.src != NO_IDENTIFIER) {
+        if(query.src >= noVertices) return cardStat {0, 0, 0};
+        Search s;
+        search(automaton, query.src, s);
+        auto n = (uint32_t) s.reached.size();
+        if(query.trg != NO_IDENTIFIER) n = std::find(s.reached.begin(), s.reached.end(), query.trg) != s.reached.end();
+        return cardStat {n ? 1u : 0u, n, n};
+    }
+
+    std::vector<uint32_t> starts;
+    for(auto labelDir : query.path.front().labels) {
+        auto sources = (labelDir.reverse ? graph->POS : graph->PSO).sources(labelDir.label);
+        starts.insert(starts.end(), sources.begin(), sources.end());
+    }
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    CardinalityCounter counter(noVertices);
+
+    countFrom(automaton, starts, counter);
+    return counter.result();
+}
@@ -1,14 +1,154 @@
 #include "Bench.h"
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <fstream>
+#include <sstream>
 #include <SimpleGraph.h>
 #include <Estimator.h>
 #include <SimpleEstimator.h>
 #include <SimpleEvaluator.h>
+#include <AutomatonEvaluator.h>
 #include "Query.h"
 #include "QueryParser.h"
+#include "GraphSnapshot.h"
 
 
+bool parseBenchOptions(int argc, char *argv[], int first, struct benchconfig_t &config) {
+
+    for(int i = first; i < argc; i++) {
+        std::string option {argv[i]};
+        if(i + 1 >= argc) {
+            std::cerr << "Missing value for option " << option << std::endl;
+            return false;
+        }
+        std::string value {argv[++i]};
+
+        try {
+            if(option == "--mode") {
+                if(value != "evaluator" && value != "estimator") throw std::invalid_argument(value);
+                config.mode = value;
+            } else if(option == "--json") {
+                config.jsonFile = value;
+            } else if(option == "--load-threads") {
+                config.loadThreads = (uint32_t) std::stoul(value);
+            } else if(option == "--join-order") {
+                if(value != "planned" && value != "textual" && value != "compare") throw std::invalid_argument(value);
+                config.joinOrder = value;
+            } else if(option == "--engine") {
+                if(value != "relational" && value != "automaton" && value != "compare") throw std::invalid_argument(value);
+                config.engine = value;
+            } else if(option == "--threads") {
+                config.evalThreads = (uint32_t) std::stoul(value);
+            } else if(option == "--cache-mb") {
+                config.cacheMiB = std::stoull(value);
+            } else if(option == "--approx") {
+                if(value != "on" && value != "off") throw std::invalid_argument(value);
+                config.approximate = value == "on";
+            } else if(option == "--batch") {
+                if(value != "on" && value != "off") throw std::invalid_argument(value);
+                config.batch = value == "on";
+            } else if(option == "--concurrency") {
+                config.concurrency = (uint32_t) std::stoul(value);
+                if(config.concurrency == 0) throw std::invalid_argument(value);
+            } else if(option == "--sample-budget") {
+                config.sampleBudget = std::stoull(value);
+            } else if(option == "--seed") {
+                config.seed = std::stoull(value);
+            } else if(option == "--speedup") {
+                config.speedupThreads.clear();
+                std::stringstream list {value};
+                for(std::string item; std::getline(list, item, ',');) {
+                    config.speedupThreads.push_back((uint32_t) std::stoul(item));
+                }
+                if(config.speedupThreads.empty()) throw std::invalid_argument(value);
+            } else {
+                std::cerr << "Unknown option " << option << std::endl;
+                return false;
+            }
+        } catch (std::logic_error &e) {
+            std::cerr << "Invalid value for option " << option << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    // a batch and concurrent queries are evaluated by the relational engine in the planned join order only
+    if(config.batch && config.concurrency > 1) {
+        std::cerr << "Options --batch on and --concurrency cannot be combined" << std::endl;
+        return false;
+    }
+    if((config.batch || config.concurrency > 1) && (config.engine != "relational" || config.joinOrder == "compare")) {
+        std::cerr << "Options --batch on and --concurrency need --engine relational and no --join-order compare" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void printBenchOptions() {
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --mode <m>           evaluator (time the evaluation) or estimator (q-error and latency of the" << std::endl;
+    std::cout << "                       estimates per query class) (default: evaluator)" << std::endl;
+    std::cout << "  --json <file>        estimator mode: also write the report as JSON to file" << std::endl;
+    std::cout << "  --load-threads <n>   threads used to parse the graph file (default: all cores)" << std::endl;
+    std::cout << "  --join-order <o>     planned (cheapest estimated order), textual (left-deep, as written)," << std::endl;
+    std::cout << "                       or compare (run both, report both times) (default: planned)" << std::endl;
+    std::cout << "  --engine <e>         relational (joins and unions), automaton (product graph search)," << std::endl;
+    std::cout << "                       or compare (run both, report both times) (default: relational)" << std::endl;
+    std::cout << "  --threads <n>        threads used to evaluate the queries (default: all cores)" << std::endl;
+    std::cout << "  --cache-mb <n>       memory budget of the sub-plan cache in MiB (default: 256)" << std::endl;
+    std::cout << "  --approx <on|off>    count the distinct targets (noIn) of the answers with a sketch" << std::endl;
+    std::cout << "                       instead of a bitset over all vertices (default: off)" << std::endl;
+    std::cout << "  --batch <on|off>     evaluate the whole workload at once, sharing work between queries" << std::endl;
+    std::cout << "                       (only the total time is reported) (default: off)" << std::endl;
+    std::cout << "  --concurrency <n>    evaluate n queries at once on a pool of n workers and report the" << std::endl;
+    std::cout << "                       throughput and latency percentiles; combine with --threads 1 to keep" << std::endl;
+    std::cout << "                       every query on its worker (default: 1, query by query)" << std::endl;
+    std::cout << "                       --batch and --concurrency exclude each other, and both need the" << std::endl;
+    std::cout << "                       relational engine and no --join-order compare" << std::endl;
+    std::cout << "  --sample-budget <n>  estimate paths of more than two entries and closures by sampling," << std::endl;
+    std::cout << "                       n edge visits per estimate, e.g. 65536 (default: 0, no sampling)" << std::endl;
+    std::cout << "  --seed <n>           seed of the sampling, the same seed gives the same estimates (default: 1)" << std::endl;
+    std::cout << "  --speedup <n,m,..>   benchmarker only: run every workload with each thread count and" << std::endl;
+    std::cout << "                       report the per-query speedup over the first, e.g. 1,4,16" << std::endl;
+}
+
+/**
+ * Read a graph either from a text file (graph.nt) or from a binary snapshot.
+ * @param g The graph to fill.
+ * @param graphFile Graph or snapshot file, told apart by the snapshot magic.
+ * @param config Benchmark options (load threads).
+ */
+void loadGraph(std::shared_ptr<SimpleGraph> &g, const std::string &graphFile, const struct benchconfig_t &config) {
+    if(GraphSnapshot::isSnapshot(graphFile)) {
+        GraphSnapshot::read(*g, graphFile);
+    } else {
+        g->readFromContiguousFile(graphFile, config.loadThreads);
+    }
+}
+
+int convertGraph(std::string &graphFile, std::string &snapshotFile, const struct benchconfig_t &config) {
+
+    auto g = std::make_shared<SimpleGraph>();
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        g->readFromContiguousFile(graphFile, config.loadThreads);
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "Time to read the graph into memory: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        GraphSnapshot::write(*g, snapshotFile);
+        end = std::chrono::steady_clock::now();
+        std::cout << "Time to write the snapshot: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
 std::vector<Triple> parseQueries(std::string &fileName) {
 
     std::vector<Triple> queries {};
@@ -39,7 +179,78 @@ std::vector<Triple> parseQueries(std::string &fileName) {
     return queries;
 }
 
-int estimatorBench(std::string &graphFile, std::string &queriesFile) {
+static const std::vector<std::string> QUERY_CLASSES {"single", "chain", "union", "closure", "bound"};
+
+/**
+ * The class of a query in the estimator benchmark, by what its estimate has to get right: a constant
+ * endpoint, else a closure, else a union, else a chain of labels or a single label.
+ * @param q The query.
+ * @return One of QUERY_CLASSES.
+ */
+std::string queryClass(const Triple &q) {
+    if(q.src != NO_IDENTIFIER || q.trg != NO_IDENTIFIER) return "bound";
+    if(std::any_of(q.path.begin(), q.path.end(), [](const PathEntry &pe) { return pe.kleene; })) return "closure";
+    if(std::any_of(q.path.begin(), q.path.end(), [](const PathEntry &pe) { return pe.labels.size() > 1; })) return "union";
+    return q.path.size() > 1 ? "chain" : "single";
+}
+
+// how far off an estimate is, a factor of at least 1 either way (a count of 0 taken as 1)
+double qError(uint32_t estimate, uint32_t actual) {
+    double e = std::max(estimate, 1u), a = std::max(actual, 1u);
+    return std::max(e / a, a / e);
+}
+
+struct distribution_t {
+    size_t count;
+    double median, p90, max;
+};
+
+distribution_t summarize(std::vector<double> values) {
+    if(values.empty()) return {};
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) { return values[(size_t) (p * double(values.size() - 1) + 0.5)]; };
+    return {values.size(), percentile(0.5), percentile(0.9), values.back()};
+}
+
+/**
+ * The q-errors and latencies of the queries of a class over some workloads.
+ * @param results The workloads.
+ * @param cls A query class, or "all".
+ * @param qErrors Receives the distribution of the q-errors.
+ * @param latencies Receives the distribution of the latencies (us).
+ */
+void summarizeClass(const std::vector<struct estimatorresult_t> &results, const std::string &cls,
+                    distribution_t &qErrors, distribution_t &latencies) {
+    std::vector<double> q, l;
+    for(const auto &result : results) {
+        for(const auto &query : result.queries) {
+            if(cls != "all" && query.queryClass != cls) continue;
+            q.push_back(query.qError);
+            l.push_back(query.latencyUs);
+        }
+    }
+    qErrors = summarize(q);
+    latencies = summarize(l);
+}
+
+void printEstimatorSummary(const std::vector<struct estimatorresult_t> &results) {
+    std::cout << "\nq-error of noPaths and time per estimate, by query class:" << std::endl;
+    std::cout << "class\tqueries\tq-error median\tp90\tmax\tlatency (us) median\tp90\tmax" << std::endl;
+    auto classes = QUERY_CLASSES;
+    classes.emplace_back("all");
+    for(const auto &cls : classes) {
+        distribution_t qErrors, latencies;
+        summarizeClass(results, cls, qErrors, latencies);
+        if(qErrors.count == 0) continue;
+        std::cout << cls << "\t" << qErrors.count << "\t" << qErrors.median << "\t" << qErrors.p90 << "\t" << qErrors.max
+                  << "\t" << latencies.median << "\t" << latencies.p90 << "\t" << latencies.max << std::endl;
+    }
+}
+
+struct estimatorresult_t estimatorBench(std::string &graphFile, std::string &queriesFile, const struct benchconfig_t &config) {
+    struct estimatorresult_t result = {};
+    result.graphFile = graphFile;
+    result.queriesFile = queriesFile;
 
     std::cout << "\n(1) Reading the graph into memory and preparing the estimator...\n" << std::endl;
 
@@ -48,57 +259,202 @@ int estimatorBench(std::string &graphFile, std::string &queriesFile) {
 
     auto start = std::chrono::steady_clock::now();
     try {
-        g->readFromContiguousFile(graphFile);
+        loadGraph(g, graphFile, config);
     } catch (std::runtime_error &e) {
         std::cerr << e.what() << std::endl;
-        return 0;
+        return result;
     }
 
     auto end = std::chrono::steady_clock::now();
-    std::cout << "Time to read the graph into memory: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    result.loadTime = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << "Time to read the graph into memory: " << result.loadTime << " ms" << std::endl;
 
     // prepare the estimator
-    auto est = std::make_unique<SimpleEstimator>(g);
+    auto est = std::make_shared<SimpleEstimator>(g);
+    est->setSampling(config.sampleBudget, config.seed);
     start = std::chrono::steady_clock::now();
     est->prepare();
     end = std::chrono::steady_clock::now();
-    std::cout << "Time to prepare the estimator: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    result.prepTime = std::chrono::duration<double, std::milli>(end - start).count();
+    result.statsBytes = est->getCatalog().getNoBytes() + est->getSynopsis().getNoBytes();
+    std::cout << "Time to prepare the estimator: " << result.prepTime << " ms" << std::endl;
+    std::cout << "Statistics: " << double(result.statsBytes) / 1024.0 << " KiB" << std::endl;
+
+    // the actual answers, from one evaluator for the whole workload planning with the estimator
+    auto ev = std::make_unique<SimpleEvaluator>(g);
+    ev->setNoThreads(config.evalThreads);
+    ev->setCacheBudget(config.cacheMiB << 20);
+    ev->prepare();
+    ev->attachEstimator(est);
 
     std::cout << "\n(2) Running the query workload..." << std::endl;
 
     auto queries = parseQueries(queriesFile);
 
-    for(auto query : queries) {
+    for(auto &query : queries) {
 
-        // perform estimation
-        // parse the query into an AST
-        std::cout << "\nProcessing query: " << query.toString();
+        struct estimatorquery_t record = {};
+        record.query = query.toString();
+        record.queryClass = queryClass(query);
+        std::cout << "\nProcessing query: " << record.query << " (" << record.queryClass << ")";
 
+        // an estimate can take well under a microsecond, it is repeated until the repeats can be timed
+        cardStat estimate {};
+        uint32_t noRepeats = 0;
         start = std::chrono::steady_clock::now();
-        auto estimate = est->estimate(query);
-        end = std::chrono::steady_clock::now();
+        do {
+            estimate = est->estimate(query);
+            noRepeats++;
+            end = std::chrono::steady_clock::now();
+        } while(end - start < std::chrono::microseconds(100) && noRepeats < 1000);
+        record.latencyUs = std::chrono::duration<double, std::micro>(end - start).count() / noRepeats;
 
         std::cout << "\nEstimation (noOut, noPaths, noIn) : ";
         estimate.print();
-        std::cout << "Time to estimate: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+        std::cout << "Time to estimate: " << record.latencyUs << " us" << std::endl;
 
-        // perform evaluation
-        auto ev = std::make_unique<SimpleEvaluator>(g);
-        ev->prepare();
-        start = std::chrono::steady_clock::now();
         auto actual = ev->evaluate(query);
-        end = std::chrono::steady_clock::now();
-
         std::cout << "Actual (noOut, noPaths, noIn) : ";
         actual.print();
-        std::cout << "Time to evaluate: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
 
+        record.qError = qError(estimate.noPaths, actual.noPaths);
+        std::cout << "q-error: " << record.qError << std::endl;
+
+        record.estimate[0] = estimate.noOut, record.estimate[1] = estimate.noPaths, record.estimate[2] = estimate.noIn;
+        record.actual[0] = actual.noOut, record.actual[1] = actual.noPaths, record.actual[2] = actual.noIn;
+        result.queries.push_back(record);
     }
 
-    return 0;
+    printEstimatorSummary({result});
+    return result;
+}
+
+/**
+ * Write a string as a JSON string literal.
+ */
+void writeJsonString(std::ostream &out, const std::string &s) {
+    out << '"';
+    for(auto c : s) {
+        if(c == '"' || c == '\\') out << '\\' << c;
+        else if((unsigned char) c < 0x20) out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+        else out << c;
+    }
+    out << '"';
+}
+
+void writeJsonClasses(std::ostream &out, const std::vector<struct estimatorresult_t> &results) {
+    auto distribution = [&](const distribution_t &d) {
+        out << "{\"median\": " << d.median << ", \"p90\": " << d.p90 << ", \"max\": " << d.max << "}";
+    };
+    auto classes = QUERY_CLASSES;
+    classes.emplace_back("all");
+    out << "{";
+    bool first = true;
+    for(const auto &cls : classes) {
+        distribution_t qErrors, latencies;
+        summarizeClass(results, cls, qErrors, latencies);
+        if(qErrors.count == 0) continue;
+        out << (first ? "" : ", ") << "\"" << cls << "\": {\"count\": " << qErrors.count << ", \"qError\": ";
+        distribution(qErrors);
+        out << ", \"latencyUs\": ";
+        distribution(latencies);
+        out << "}";
+        first = false;
+    }
+    out << "}";
+}
+
+bool writeEstimatorJson(const std::string &fileName, const std::vector<struct estimatorresult_t> &results, const struct benchconfig_t &config) {
+
+    std::ofstream out {fileName};
+    if(!out) return false;
+
+    out << "{\n  \"sampleBudget\": " << config.sampleBudget << ",\n  \"seed\": " << config.seed << ",\n  \"classes\": ";
+    writeJsonClasses(out, results);
+    out << ",\n  \"workloads\": [";
+
+    for(size_t w = 0; w < results.size(); w++) {
+        const auto &result = results[w];
+        out << (w ? "," : "") << "\n    {\n      \"graph\": ";
+        writeJsonString(out, result.graphFile);
+        out << ",\n      \"queries\": ";
+        writeJsonString(out, result.queriesFile);
+        out << ",\n      \"loadTimeMs\": " << result.loadTime << ",\n      \"prepTimeMs\": " << result.prepTime
+            << ",\n      \"statsBytes\": " << result.statsBytes << ",\n      \"classes\": ";
+        writeJsonClasses(out, {result});
+        out << ",\n      \"results\": [";
+
+        for(size_t q = 0; q < result.queries.size(); q++) {
+            const auto &query = result.queries[q];
+            out << (q ? "," : "") << "\n        {\"query\": ";
+            writeJsonString(out, query.query);
+            out << ", \"class\": \"" << query.queryClass << "\", \"estimate\": [" << query.estimate[0] << ", "
+                << query.estimate[1] << ", " << query.estimate[2] << "], \"actual\": [" << query.actual[0] << ", "
+                << query.actual[1] << ", " << query.actual[2] << "], \"qError\": " << query.qError
+                << ", \"latencyUs\": " << query.latencyUs << "}";
+        }
+        out << "\n      ]\n    }";
+    }
+    out << "\n  ]\n}\n";
+
+    return (bool) out;
+}
+
+void printCacheStats(const SimpleEvaluator &ev) {
+    auto cache = ev.getCacheStats();
+    std::cout << "\nSub-plan cache: " << cache.hits << " hits, " << cache.misses << " misses, " << cache.evictions
+              << " evictions, " << cache.noEntries << " entries in " << double(cache.noBytes) / 1024.0 / 1024.0 << " MiB" << std::endl;
 }
 
-struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queriesFile) {
+/**
+ * Evaluate the queries of a workload concurrently: a pool of workers takes the queries one at a time, all
+ * of them sharing the graph, the evaluator and its sub-plan cache. Prints the answers in workload order,
+ * the throughput and the latency percentiles.
+ * @param ev The evaluator.
+ * @param queries The workload.
+ * @param concurrency Number of workers (queries in flight).
+ * @param result Receives the wall time of the workload as evalTime, and the latency of every query.
+ */
+void concurrentBench(SimpleEvaluator &ev, const std::vector<Triple> &queries, uint32_t concurrency, struct benchresult_t &result) {
+
+    std::vector<cardStat> answers(queries.size());
+    std::vector<double> latencies(queries.size()); // ms
+
+    ThreadPool workers(concurrency);
+    auto start = std::chrono::steady_clock::now();
+    workers.parallelFor(0, queries.size(), 1, [&](uint64_t first, uint64_t last) {
+        for(auto q = first; q < last; q++) {
+            auto queryStart = std::chrono::steady_clock::now();
+            answers[q] = ev.evaluate(queries[q]);
+            auto queryEnd = std::chrono::steady_clock::now();
+            latencies[q] = std::chrono::duration<double, std::milli>(queryEnd - queryStart).count();
+        }
+    });
+    auto end = std::chrono::steady_clock::now();
+
+    auto counts = ev.getRelativeError() > 0 ? "Approximate" : "Actual";
+    for(size_t q = 0; q < queries.size(); q++) {
+        std::cout << "\nProcessing query: " << queries[q].toString();
+        std::cout << "\n" << counts << " (noOut, noPaths, noIn) : ";
+        answers[q].print();
+        std::cout << "Latency: " << latencies[q] << " ms" << std::endl;
+        result.queryTimes.emplace_back(queries[q].toString(), (long) latencies[q]);
+    }
+
+    auto wallTime = std::chrono::duration<double, std::milli>(end - start).count();
+    result.evalTime = (long) wallTime;
+    std::cout << "\nTime to evaluate the workload with " << concurrency << " queries at once: " << wallTime << " ms" << std::endl;
+    if(queries.empty()) return;
+
+    std::cout << "Throughput: " << double(queries.size()) / wallTime * 1000.0 << " queries/s" << std::endl;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[(size_t) (p * double(latencies.size() - 1) + 0.5)]; };
+    std::cout << "Latency (ms): p50 " << percentile(0.5) << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99)
+              << ", max " << latencies.back() << std::endl;
+}
+
+struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queriesFile, const struct benchconfig_t &config) {
     struct benchresult_t result = {};
 
     std::cout << "\n(1) Reading the graph into memory and preparing the evaluator...\n" << std::endl;
@@ -108,7 +464,7 @@ struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queries
 
     auto start = std::chrono::steady_clock::now();
     try {
-        g->readFromContiguousFile(graphFile);
+        loadGraph(g, graphFile, config);
     } catch (std::runtime_error &e) {
         std::cerr << e.what() << std::endl;
         return {};
@@ -120,19 +476,72 @@ struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queries
 
     // prepare the evaluator
     auto est = std::make_shared<SimpleEstimator>(g);
+    est->setSampling(config.sampleBudget, config.seed);
     auto ev = std::make_unique<SimpleEvaluator>(g);
+    ev->setJoinOrder(config.joinOrder == "textual" ? JoinOrder::TEXTUAL : JoinOrder::PLANNED);
+    ev->setNoThreads(config.evalThreads);
+    ev->setCacheBudget(config.cacheMiB << 20);
+    ev->setApproximate(config.approximate);
 
     start = std::chrono::steady_clock::now();
     ev->attachEstimator(est);
     ev->prepare();
+
+    // the automaton engine, either evaluating the workload or for comparison
+    std::unique_ptr<AutomatonEvaluator> automaton;
+    if(config.engine != "relational") {
+        automaton = std::make_unique<AutomatonEvaluator>(g);
+        automaton->setNoThreads(config.evalThreads);
+        automaton->prepare();
+    }
     end = std::chrono::steady_clock::now();
     result.prepTime = std::chrono::duration<double, std::milli>(end - start).count();
     std::cout << "Time to prepare the evaluator: " << result.prepTime << " ms" << std::endl;
+    // only the relational engine counts approximately, the automaton engine always counts exactly
+    bool approximate = config.approximate && config.engine != "automaton";
+    auto counts = approximate ? "Approximate" : "Actual";
+    if(approximate) {
+        std::cout << "Approximate counts: noIn within " << ev->getRelativeError() * 100 << "% (one standard error),"
+                  << " noOut and noPaths exact" << std::endl;
+    }
+
+    // for comparison: a second evaluator (with its own caches) joining in textual order
+    bool compare = config.joinOrder == "compare";
+    std::unique_ptr<SimpleEvaluator> textual;
+    if(compare) {
+        textual = std::make_unique<SimpleEvaluator>(g);
+        textual->setJoinOrder(JoinOrder::TEXTUAL);
+        textual->setNoThreads(config.evalThreads);
+        textual->setCacheBudget(config.cacheMiB << 20);
+        textual->prepare();
+    }
 
     std::cout << "\n(2) Running the query workload..." << std::endl;
 
     auto queries = parseQueries(queriesFile);
 
+    if(config.batch) {
+        start = std::chrono::steady_clock::now();
+        auto answers = ev->evaluateBatch(queries);
+        end = std::chrono::steady_clock::now();
+
+        for(size_t q = 0; q < queries.size(); q++) {
+            std::cout << "\nProcessing query: " << queries[q].toString();
+            std::cout << "\n" << counts << " (noOut, noPaths, noIn) : ";
+            answers[q].print();
+        }
+        result.evalTime = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "\nTime to evaluate the workload as a batch: " << result.evalTime << " ms" << std::endl;
+        printCacheStats(*ev);
+        return result;
+    }
+
+    if(config.concurrency > 1) {
+        concurrentBench(*ev, queries, config.concurrency, result);
+        printCacheStats(*ev);
+        return result;
+    }
+
     for(auto query : queries) {
 
         // perform evaluation
@@ -141,15 +550,47 @@ struct benchresult_t evaluatorBench(std::string &graphFile, std::string &queries
 
         // perform the evaluation
         start = std::chrono::steady_clock::now();
-        auto actual = ev->evaluate(query);
+        auto actual = config.engine == "automaton" ? automaton->evaluate(query) : ev->evaluate(query);
         end = std::chrono::steady_clock::now();
 
-        std::cout << "\nActual (noOut, noPaths, noIn) : ";
+        std::cout << "\n" << counts << " (noOut, noPaths, noIn) : ";
         actual.print();
         long localEvalTime = std::chrono::duration<double, std::milli>(end - start).count();
         std::cout << "Time to evaluate: " << localEvalTime << " ms" << std::endl;
         result.evalTime += localEvalTime;
+        result.queryTimes.emplace_back(query.toString(), localEvalTime);
+
+        if(compare) {
+            std::cout << "Join plan: " << ev->planJoins(query.path).toString(query.path) << std::endl;
+
+            start = std::chrono::steady_clock::now();
+            auto other = textual->evaluate(query);
+            end = std::chrono::steady_clock::now();
+
+            long textualEvalTime = std::chrono::duration<double, std::milli>(end - start).count();
+            std::cout << "Time to evaluate (textual join order): " << textualEvalTime << " ms" << std::endl;
+            if(other.noOut != actual.noOut || other.noPaths != actual.noPaths || other.noIn != actual.noIn) {
+                std::cout << "Textual join order disagrees: ";
+                other.print();
+            }
+            result.textualEvalTime += textualEvalTime;
+        }
+
+        if(config.engine == "compare") {
+            start = std::chrono::steady_clock::now();
+            auto other = automaton->evaluate(query);
+            end = std::chrono::steady_clock::now();
+
+            long automatonEvalTime = std::chrono::duration<double, std::milli>(end - start).count();
+            std::cout << "Time to evaluate (automaton engine): " << automatonEvalTime << " ms" << std::endl;
+            if(other.noOut != actual.noOut || other.noPaths != actual.noPaths || other.noIn != actual.noIn) {
+                std::cout << "Automaton engine disagrees: ";
+                other.print();
+            }
+            result.automatonEvalTime += automatonEvalTime;
+        }
     }
 
+    printCacheStats(*ev);
     return result;
 }
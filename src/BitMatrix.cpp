@@ -0,0 +1,64 @@
+#include "BitMatrix.h"
+
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define QS_X86_KERNELS
+#endif
+
+namespace {
+
+    void orPortable(uint64_t *acc, const uint64_t *row, size_t stride) {
+        for(size_t w = 0; w < stride; w++) acc[w] |= row[w];
+    }
+
+#ifdef QS_X86_KERNELS
+    __attribute__((target("avx2")))
+    void orAvx2(uint64_t *acc, const uint64_t *row, size_t stride) {
+        for(size_t w = 0; w < stride; w += 4) {
+            auto a = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + w));
+            auto r = _mm256_load_si256(reinterpret_cast<const __m256i *>(row + w));
+            _mm256_store_si256(reinterpret_cast<__m256i *>(acc + w), _mm256_or_si256(a, r));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    void orAvx512(uint64_t *acc, const uint64_t *row, size_t stride) {
+        for(size_t w = 0; w < stride; w += 8) {
+            auto a = _mm512_load_si512(acc + w);
+            auto r = _mm512_load_si512(row + w);
+            _mm512_store_si512(acc + w, _mm512_or_si512(a, r));
+        }
+    }
+#endif
+
+    using OrKernel = void (*)(uint64_t *, const uint64_t *, size_t);
+
+    OrKernel pickKernel() {
+#ifdef QS_X86_KERNELS
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")) return orAvx512;
+        if(__builtin_cpu_supports("avx2")) return orAvx2;
+#endif
+        return orPortable;
+    }
+
+}
+
+void BitMatrix::orInto(uint64_t *acc, const uint64_t *row, size_t stride) {
+    static const OrKernel kernel = pickKernel();
+    kernel(acc, row, stride);
+}
+
+BitMatrix::Words BitMatrix::allocateWords(size_t words) {
+    size_t bytes = (std::max<size_t>(words, 1) + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK * WORDS_PER_BLOCK * sizeof(uint64_t);
+    auto p = static_cast<uint64_t *>(std::aligned_alloc(64, bytes));
+    if(p == nullptr) throw std::bad_alloc();
+    std::memset(p, 0, bytes);
+    return Words(p);
+}
+
+BitMatrix::BitMatrix(uint32_t noColumns, size_t noRows)
+        : stride(strideFor(noColumns)), noRows(noRows), bits(allocateWords(stride * noRows)) {}
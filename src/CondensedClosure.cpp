@@ -0,0 +1,172 @@
+#include "CondensedClosure.h"
+#include "VisitedSet.h"
+
+#include <algorithm>
+
+namespace {
+
+    ArrayView<uint32_t> edgesOf(const Relation &base, uint32_t vertex) {
+        size_t row = base.find(vertex);
+        return row == Relation::NO_ROW ? ArrayView<uint32_t>() : base.targetsAt(row);
+    }
+
+}
+
+CondensedClosure::CondensedClosure(const Relation &base) {
+    findComponents(base);
+    condense(base);
+}
+
+/**
+ * Tarjan's algorithm with an explicit call stack (long paths would overflow the native one).
+ * A component is numbered when it is closed, after every component it can reach, so the
+ * numbering is a reverse topological order of the condensation.
+ * @param base The relation to close.
+ */
+void CondensedClosure::findComponents(const Relation &base) {
+
+    const uint32_t UNVISITED = UINT32_MAX;
+    uint32_t noVertices = base.getNoVertices();
+
+    std::vector<uint32_t> order(noVertices, UNVISITED), low(noVertices);
+    std::vector<uint32_t> open;                         // vertices not yet assigned to a component
+    struct Call {
+        uint32_t vertex;
+        ArrayView<uint32_t> edges;
+        size_t next;
+    };
+    std::vector<Call> calls;                            // the emulated recursion
+    uint32_t noVisited = 0;
+
+    componentOf.assign(noVertices, UNVISITED);
+    memberOffsets.assign(1, 0);
+    members.clear();
+    members.reserve(noVertices);
+
+    for(uint32_t root = 0; root < noVertices; root++) {
+        if(order[root] != UNVISITED) continue;
+
+        order[root] = low[root] = noVisited++;
+        open.push_back(root);
+        calls.push_back({root, edgesOf(base, root), 0});
+
+        while(!calls.empty()) {
+            uint32_t vertex = calls.back().vertex;
+            auto &edges = calls.back().edges;
+
+            if(calls.back().next < edges.size()) {
+                uint32_t target = edges[calls.back().next++];
+                if(order[target] == UNVISITED) {
+                    order[target] = low[target] = noVisited++;
+                    open.push_back(target);
+                    calls.push_back({target, edgesOf(base, target), 0});
+                } else if(componentOf[target] == UNVISITED) {
+                    low[vertex] = std::min(low[vertex], order[target]);
+                }
+                continue;
+            }
+
+            calls.pop_back();
+            if(!calls.empty()) {
+                uint32_t parent = calls.back().vertex;
+                low[parent] = std::min(low[parent], low[vertex]);
+            }
+            if(low[vertex] != order[vertex]) continue;
+
+            // vertex is the root of a component: everything above it on the open stack belongs to it
+            auto c = (uint32_t) memberOffsets.size() - 1;
+            size_t first = members.size();
+            uint32_t member;
+            do {
+                member = open.back();
+                open.pop_back();
+                componentOf[member] = c;
+                members.push_back(member);
+            } while(member != vertex);
+            std::sort(members.begin() + first, members.end());
+            memberOffsets.push_back((uint32_t) members.size());
+        }
+    }
+}
+
+/**
+ * Compute the components reachable from every component. Components are visited in their (reverse
+ * topological) order, so the sets of all successors are complete when a component is visited.
+ * A successor that is already in the set was reached through another successor, and so was
+ * everything it reaches: its set does not have to be merged again.
+ * @param base The relation to close.
+ */
+void CondensedClosure::condense(const Relation &base) {
+
+    uint32_t noComponents = getNoComponents();
+    reachOffsets.assign(1, 0);
+    reach.clear();
+    noReachable.assign(noComponents, 0);
+    hasPredecessor.assign(noComponents, 0);
+
+    VisitedSet seen;
+    std::vector<uint32_t> reached;
+
+    for(uint32_t c = 0; c < noComponents; c++) {
+        seen.clear(noComponents);
+        reached.clear();
+
+        for(auto vertex : componentMembers(c)) {
+            for(auto target : edgesOf(base, vertex)) {
+                uint32_t d = componentOf[target];
+                hasPredecessor[d] = 1;
+                if(!seen.insert(d)) continue;
+                reached.push_back(d);
+                if(d == c) continue; // an edge inside the component: c lies on a cycle
+
+                for(auto e : reachable(d)) {
+                    if(seen.insert(e)) reached.push_back(e);
+                }
+            }
+        }
+
+        std::sort(reached.begin(), reached.end());
+        reach.insert(reach.end(), reached.begin(), reached.end());
+        reachOffsets.push_back(reach.size());
+
+        for(auto d : reached) noReachable[c] += memberOffsets[d + 1] - memberOffsets[d];
+    }
+}
+
+/**
+ * Materialize the closure row shared by all vertices of a component.
+ * @param c The component.
+ * @param out Receives the reachable vertices, sorted.
+ */
+void CondensedClosure::row(uint32_t c, std::vector<uint32_t> &out) const {
+    out.clear();
+    out.reserve(noReachable[c]);
+    for(auto d : reachable(c)) {
+        auto m = componentMembers(d);
+        out.insert(out.end(), m.begin(), m.end());
+    }
+    std::sort(out.begin(), out.end());
+}
+
+/**
+ * Count the closure: a component contributes (its size) x (vertices it reaches) pairs, and a vertex
+ * is a target iff it has an incoming edge in the base relation.
+ * @return (noOut, noPaths, noIn) of the closure.
+ */
+cardStat CondensedClosure::stats() const {
+
+    uint64_t noOut = 0, noPaths = 0, noIn = 0;
+    for(uint32_t c = 0; c < getNoComponents(); c++) {
+        uint64_t size = memberOffsets[c + 1] - memberOffsets[c];
+        if(noReachable[c] > 0) noOut += size;
+        noPaths += size * noReachable[c];
+        if(hasPredecessor[c]) noIn += size;
+    }
+
+    return cardStat {(uint32_t) noOut, (uint32_t) noPaths, (uint32_t) noIn};
+}
+
+uint64_t CondensedClosure::getNoBytes() const {
+    return (componentOf.size() + memberOffsets.size() + members.size() + reach.size()) * sizeof(uint32_t)
+           + (reachOffsets.size() + noReachable.size()) * sizeof(uint64_t) + hasPredecessor.size();
+}
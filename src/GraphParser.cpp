@@ -0,0 +1,18 @@
+#include "GraphParser.h"
+
+GraphHeader GraphParser::header() {
+    GraphHeader header {};
+
+    bool valid = number(header.noNodes)
+                 && _cur < _end && *_cur++ == ','
+                 && number(header.noEdges)
+                 && _cur < _end && *_cur++ == ','
+                 && number(header.noLabels)
+                 && endOfLine();
+    if(!valid) {
+        throw std::runtime_error(std::string("Invalid graph header!"));
+    }
+
+    _line++;
+    return header;
+}
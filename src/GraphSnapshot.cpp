@@ -0,0 +1,186 @@
+#include "GraphSnapshot.h"
+#include "AdjacencyIndex.h"
+#include "MappedFile.h"
+#include "SimpleGraph.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+    /*
+     * Streaming 64-bit checksum over 8-byte words (the payload is always a multiple of 8 bytes).
+     */
+    struct Checksum {
+        uint64_t h = 0x9E3779B97F4A7C15ULL;
+
+        void update(const char *data, size_t size) {
+            for(size_t i = 0; i + 8 <= size; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, data + i, 8);
+                h ^= word * 0xC2B2AE3D27D4EB4FULL;
+                h = ((h << 31) | (h >> 33)) * 0x9E3779B185EBCA87ULL;
+            }
+        }
+    };
+
+    size_t padded(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+
+    [[noreturn]] void invalid(const std::string &fileName, const std::string &what) {
+        throw std::runtime_error("Invalid graph snapshot " + fileName + ": " + what);
+    }
+
+    template<typename T>
+    ArrayView<T> sectionView(const MappedFile &file, const GraphSnapshot::SectionEntry &section) {
+        return {reinterpret_cast<const T *>(file.data() + section.offset), section.size / sizeof(T)};
+    }
+
+    /*
+     * Are the arrays of a CSR (with consistent sizes) safe to follow? Offsets start at 0 and never go back,
+     * the vertices of a label and the targets of a vertex are strictly ascending and below noVertices.
+     */
+    bool wellFormed(ArrayView<uint64_t> labelOffsets, ArrayView<uint32_t> vertices, ArrayView<uint64_t> edgeOffsets,
+                    ArrayView<uint32_t> targets, uint32_t noVertices) {
+        auto ascending = [&](ArrayView<uint32_t> ids, ArrayView<uint64_t> offsets) {
+            if(offsets[0] != 0) return false;
+            for(size_t i = 0; i + 1 < offsets.size(); i++) {
+                if(offsets[i] > offsets[i + 1]) return false;
+                for(auto j = offsets[i]; j < offsets[i + 1]; j++) {
+                    if(ids[j] >= noVertices || (j > offsets[i] && ids[j] <= ids[j - 1])) return false;
+                }
+            }
+            return true;
+        };
+        return ascending(vertices, labelOffsets) && ascending(targets, edgeOffsets);
+    }
+
+}
+
+bool GraphSnapshot::isSnapshot(const std::string &fileName) {
+    std::ifstream file { fileName, std::ios::binary };
+    char magic[sizeof(MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+ * Write a snapshot of a loaded graph.
+ * @param g The graph to write.
+ * @param fileName Snapshot file to create.
+ */
+void GraphSnapshot::write(const SimpleGraph &g, const std::string &fileName) {
+
+    const AdjacencyIndex &pso = g.PSO, &pos = g.POS;
+
+    const std::pair<const void *, size_t> arrays[NO_SECTIONS] = {
+            {pso.labelOffsets.begin(), pso.labelOffsets.size() * sizeof(uint64_t)},
+            {pso.vertices.begin(), pso.vertices.size() * sizeof(uint32_t)},
+            {pso.edgeOffsets.begin(), pso.edgeOffsets.size() * sizeof(uint64_t)},
+            {pso.targets.begin(), pso.targets.size() * sizeof(uint32_t)},
+            {pos.labelOffsets.begin(), pos.labelOffsets.size() * sizeof(uint64_t)},
+            {pos.vertices.begin(), pos.vertices.size() * sizeof(uint32_t)},
+            {pos.edgeOffsets.begin(), pos.edgeOffsets.size() * sizeof(uint64_t)},
+            {pos.targets.begin(), pos.targets.size() * sizeof(uint32_t)},
+    };
+
+    Header header {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = 0;
+    header.noVertices = g.getNoVertices();
+    header.noLabels = g.getNoLabels();
+    header.noEdges = pso.getNoEdges();
+
+    uint64_t offset = padded(sizeof(Header));
+    for(uint32_t s = 0; s < NO_SECTIONS; s++) {
+        header.sections[s] = SectionEntry {offset, arrays[s].second};
+        offset += padded(arrays[s].second);
+    }
+    header.payloadSize = offset - padded(sizeof(Header));
+
+    std::ofstream file { fileName, std::ios::binary | std::ios::trunc };
+    if(!file) throw std::runtime_error("Unable to create graph snapshot " + fileName);
+
+    // header first with a zero checksum, patched once the payload is written
+    const char zeros[8] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(zeros, padded(sizeof(Header)) - sizeof(Header));
+
+    Checksum checksum;
+    for(auto &array : arrays) {
+        auto bytes = static_cast<const char *>(array.first);
+        size_t aligned = array.second & ~size_t(7);
+        checksum.update(bytes, aligned);
+        file.write(bytes, array.second);
+
+        size_t padding = padded(array.second) - array.second;
+        if(padding) {
+            char tail[8] = {};
+            std::memcpy(tail, bytes + aligned, array.second - aligned);
+            checksum.update(tail, 8);
+            file.write(zeros, padding);
+        }
+    }
+
+    header.checksum = checksum.h;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    if(!file) throw std::runtime_error("Unable to write graph snapshot " + fileName);
+}
+
+/**
+ * Read a snapshot into an (empty) graph.
+ * @param g The graph to fill.
+ * @param fileName Snapshot file.
+ */
+void GraphSnapshot::read(SimpleGraph &g, const std::string &fileName) {
+
+    auto mapping = std::make_shared<MappedFile>(fileName);
+    const MappedFile &file = *mapping;
+
+    if(file.size() < sizeof(Header)) invalid(fileName, "truncated header");
+    Header header {};
+    std::memcpy(&header, file.data(), sizeof(Header));
+
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) invalid(fileName, "bad magic");
+    if(header.version != VERSION) invalid(fileName, "unsupported version " + std::to_string(header.version));
+    if(padded(sizeof(Header)) + header.payloadSize != file.size()) invalid(fileName, "size mismatch");
+
+    for(auto &section : header.sections) {
+        if(section.offset % 8 != 0 || section.offset > file.size() || section.size > file.size() - section.offset)
+            invalid(fileName, "section out of bounds");
+    }
+
+    file.adviseSequential();
+    Checksum checksum;
+    checksum.update(file.data() + padded(sizeof(Header)), header.payloadSize);
+    if(checksum.h != header.checksum) invalid(fileName, "checksum mismatch");
+
+    g.setNoVertices(header.noVertices);
+    g.setNoLabels(header.noLabels);
+
+    // PSO/POS point straight into the mapping, no per-edge work
+    for(uint32_t d = 0; d < 2; d++) {
+        auto base = d == 0 ? PSO_LABEL_OFFSETS : POS_LABEL_OFFSETS;
+        auto labelOffsets = sectionView<uint64_t>(file, header.sections[base]);
+        auto vertices = sectionView<uint32_t>(file, header.sections[base + 1]);
+        auto edgeOffsets = sectionView<uint64_t>(file, header.sections[base + 2]);
+        auto targets = sectionView<uint32_t>(file, header.sections[base + 3]);
+
+        if(labelOffsets.size() != (size_t) header.noLabels + 1
+           || edgeOffsets.size() != vertices.size() + 1
+           || labelOffsets[header.noLabels] != vertices.size()
+           || edgeOffsets[vertices.size()] != targets.size()
+           || targets.size() != header.noEdges)
+            invalid(fileName, "inconsistent index");
+        if(!wellFormed(labelOffsets, vertices, edgeOffsets, targets, header.noVertices))
+            invalid(fileName, "malformed index");
+
+        (d == 0 ? g.PSO : g.POS).attach(labelOffsets, vertices, edgeOffsets, targets);
+    }
+    g.snapshot = mapping;
+}
@@ -0,0 +1,84 @@
+#include "JoinPlanner.h"
+#include "SimpleEstimator.h"
+
+#include <limits>
+#include <sstream>
+
+namespace {
+
+    void appendPlan(std::ostringstream &out, const JoinPlan &plan, const std::vector<PathEntry> &path, uint32_t i, uint32_t j) {
+        if(i == j) {
+            path[i].appendTo(out);
+            return;
+        }
+        out << '(';
+        appendPlan(out, plan, path, i, plan.split(i, j));
+        out << '/';
+        appendPlan(out, plan, path, plan.split(i, j) + 1, j);
+        out << ')';
+    }
+
+}
+
+std::string JoinPlan::toString(const std::vector<PathEntry> &path) const {
+    std::ostringstream out;
+    if(n > 0) appendPlan(out, *this, path, 0, n - 1);
+    return out.str();
+}
+
+JoinPlan JoinPlan::leftDeep(uint32_t noEntries) {
+    JoinPlan plan(noEntries);
+    for(uint32_t i = 0; i < noEntries; i++) {
+        for(uint32_t j = i + 1; j < noEntries; j++) plan.setSplit(i, j, j - 1);
+    }
+    return plan;
+}
+
+/**
+ * Find the cheapest join order of a concatenation. A join costs the paths of its left input, each of
+ * which probes the right input, plus the paths it produces. The sub-paths [0, j] form the left spine
+ * that countPipelined streams through a pipeline, so there a right child of one entry is expanded
+ * straight from its operand and costs nothing beyond the probes; every other sub-path is materialized.
+ * @param est A prepared estimator.
+ * @param path The concatenation.
+ * @return The cheapest plan; among equally cheap splits the textual (left-deep) one is kept.
+ */
+JoinPlan JoinPlanner::plan(SimpleEstimator &est, const std::vector<PathEntry> &path) {
+
+    auto n = (uint32_t) path.size();
+    JoinPlan plan(n);
+    if(n == 0) return plan;
+
+    std::vector<cardStat> card((size_t) n * n);
+    std::vector<double> cost((size_t) n * n);
+    auto at = [n](uint32_t i, uint32_t j) { return (size_t) i * n + j; };
+
+    for(uint32_t i = 0; i < n; i++) {
+        Triple entry {NO_IDENTIFIER, {path[i]}, NO_IDENTIFIER};
+        card[at(i, i)] = est.estimate(entry);
+        cost[at(i, i)] = card[at(i, i)].noPaths;
+    }
+
+    for(uint32_t length = 2; length <= n; length++) {
+        for(uint32_t i = 0; i + length <= n; i++) {
+            uint32_t j = i + length - 1;
+
+            // the estimate of a sub-path does not depend on how it is split
+            card[at(i, j)] = est.concatenation(card[at(i, j - 1)], card[at(j, j)], path[j - 1], path[j]);
+
+            double best = std::numeric_limits<double>::infinity();
+            for(uint32_t k = j; k-- > i;) {
+                double c = cost[at(i, k)] + card[at(i, k)].noPaths;
+                if(i > 0 || k + 1 < j) c += cost[at(k + 1, j)];
+                if(c < best) {
+                    best = c;
+                    plan.setSplit(i, j, k);
+                }
+            }
+            cost[at(i, j)] = best + card[at(i, j)].noPaths;
+        }
+    }
+
+    plan.cost = cost[at(0, n - 1)];
+    return plan;
+}
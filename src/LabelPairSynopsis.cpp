@@ -0,0 +1,113 @@
+#include "LabelPairSynopsis.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+void LabelPairSynopsis::build(const SimpleGraph &g, const StatisticsCatalog &catalog, uint32_t noThreads) {
+
+    auto noLabels = g.getNoLabels();
+    auto noVertices = g.getNoVertices();
+
+    // the labels with the most edges, both directions of each
+    std::vector<uint32_t> byEdges(noLabels);
+    std::iota(byEdges.begin(), byEdges.end(), 0);
+    std::stable_sort(byEdges.begin(), byEdges.end(), [&](uint32_t a, uint32_t b) {
+        return catalog.label(a).noPairs > catalog.label(b).noPairs;
+    });
+    labelDirs.clear();
+    slots.assign((size_t) 2 * noLabels, NO_SLOT);
+    for(auto label : byEdges) {
+        if(labelDirs.size() + 2 > MAX_LABEL_DIRS || catalog.label(label).noPairs == 0) break;
+        for(uint32_t reverse = 0; reverse < 2; reverse++) {
+            slots[label << 1 | reverse] = (uint8_t) labelDirs.size();
+            labelDirs.push_back({label, reverse});
+        }
+    }
+    auto k = labelDirs.size();
+    pairs.assign(k * k, {});
+
+    // edges of a label direction, and the same edges from their targets
+    auto out = [&](LabelDir labelDir) -> const AdjacencyIndex & { return labelDir.reverse ? g.POS : g.PSO; };
+    auto in = [&](LabelDir labelDir) -> const AdjacencyIndex & { return labelDir.reverse ? g.PSO : g.POS; };
+
+    // per vertex, the slots it has an edge of: masks[0] going out of it, masks[1] coming into it
+    std::vector<uint64_t> masks[2] {std::vector<uint64_t>(noVertices), std::vector<uint64_t>(noVertices)};
+
+    if(g.PSO.vertices.size() + g.POS.vertices.size() < StatisticsCatalog::MIN_PARALLEL_VERTICES) noThreads = 1;
+    ThreadPool pool(noThreads);
+
+    // The vertices are swept in ranges, every range with a cursor per label direction and side into the
+    // (ascending) vertices of that index: the masks of the range are set from where the cursors stand, and
+    // every vertex m joins its a-edges in with its b-edges out, the degrees read at the cursors of its bits
+    std::mutex lock;
+    pool.parallelFor(0, noVertices, SWEEP_GRAIN, [&](uint64_t first, uint64_t last) {
+        std::vector<uint64_t> starts[2], degrees[2];
+        for(int into = 0; into < 2; into++) {
+            starts[into].resize(k);
+            degrees[into].resize(k);
+            for(size_t slot = 0; slot < k; slot++) {
+                auto labelDir = labelDirs[slot];
+                const auto &index = into ? in(labelDir) : out(labelDir);
+                auto vertices = index.sources(labelDir.label);
+                auto i = (size_t) (std::lower_bound(vertices.begin(), vertices.end(), (uint32_t) first) - vertices.begin());
+                starts[into][slot] = index.labelOffsets[labelDir.label] + i;
+                for(; i < vertices.size() && vertices[i] < last; i++) masks[into][vertices[i]] |= 1ULL << slot;
+            }
+        }
+
+        std::vector<uint64_t> joined(k * k, 0);
+        auto cursors = starts;
+        for(auto m = first; m < last; m++) {
+            for(int into = 0; into < 2; into++) {
+                for(auto mask = masks[into][m]; mask != 0; mask &= mask - 1) {
+                    auto slot = __builtin_ctzll(mask);
+                    const auto &index = into ? in(labelDirs[slot]) : out(labelDirs[slot]);
+                    degrees[into][slot] = index.neighboursAt(cursors[into][slot]++).size();
+                }
+            }
+            for(auto ins = masks[1][m]; ins != 0; ins &= ins - 1) {
+                auto a = __builtin_ctzll(ins);
+                for(auto outs = masks[0][m]; outs != 0; outs &= outs - 1) {
+                    auto b = __builtin_ctzll(outs);
+                    joined[a * k + b] += degrees[1][a] * degrees[0][b];
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        for(size_t i = 0; i < k * k; i++) pairs[i].noPaths += joined[i];
+    });
+
+    // task 2a: the row of a (distinct sources of a/b: a source of a reaches b over the middle vertices it
+    // has an a-edge to), task 2b + 1: the column of b (distinct targets of a/b: a target of b is reached
+    // from a over the middle vertices it has a b-edge from). A label with more than SAMPLE_EDGES edges
+    // has every stride-th of its vertices looked at, and the counts scaled up
+    pool.parallelFor(0, 2 * k, 1, [&](uint64_t first, uint64_t last) {
+        std::vector<uint64_t> counts(k);
+        for(auto task = first; task < last; task++) {
+            auto slot = task / 2;
+            auto labelDir = labelDirs[slot];
+            bool into = task % 2;
+            const auto &index = into ? in(labelDir) : out(labelDir);
+            auto vertices = index.sources(labelDir.label);
+            auto stride = std::max<uint64_t>(1, (index.getNoEdges(labelDir.label) + SAMPLE_EDGES - 1) / SAMPLE_EDGES);
+
+            std::fill(counts.begin(), counts.end(), 0);
+            uint64_t noSampled = 0;
+            for(size_t i = 0; i < vertices.size(); i += stride, noSampled++) {
+                uint64_t mask = 0;
+                for(auto m : index.neighboursAt(index.labelOffsets[labelDir.label] + i)) mask |= masks[into][m];
+                for(; mask != 0; mask &= mask - 1) counts[__builtin_ctzll(mask)]++;
+            }
+
+            for(size_t other = 0; other < k; other++) {
+                auto count = noSampled == vertices.size() ? counts[other] : counts[other] * vertices.size() / noSampled;
+                if(into) pairs[other * k + slot].noIn = count;
+                else pairs[slot * k + other].noOut = count;
+            }
+        }
+    });
+}
@@ -0,0 +1,40 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &fileName) {
+
+    fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error(std::string("Unable to open file: ") + fileName);
+
+    struct stat st {};
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Unable to stat file: ") + fileName);
+    }
+
+    len = (size_t) st.st_size;
+    if(len == 0) return; // nothing to map, data() stays null
+
+    addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED) {
+        addr = nullptr;
+        close(fd);
+        throw std::runtime_error(std::string("Unable to map file: ") + fileName);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if(addr != nullptr) munmap(addr, len);
+    if(fd >= 0) close(fd);
+}
+
+void MappedFile::adviseSequential() const {
+    if(addr == nullptr) return;
+    madvise(addr, len, MADV_SEQUENTIAL);
+    madvise(addr, len, MADV_WILLNEED);
+}
@@ -0,0 +1,147 @@
+#include "PathPipeline.h"
+
+#include <algorithm>
+
+PathPipeline::PathPipeline(const std::vector<Step> &steps, uint32_t noVertices, std::vector<CardinalityCounter> counters)
+        : steps(steps), noVertices(noVertices), states(steps.size()), counters(std::move(counters)) {
+    for(size_t k = 0; k < steps.size(); k++) {
+        states[k].out.reserve(BATCH_SIZE);
+        states[k].bits = steps[k].isBits();
+        if(states[k].bits) states[k].acc = BitMatrix::allocateWords(steps[k].relations[0]->getStride());
+    }
+}
+
+void PathPipeline::chain(std::vector<Step> &steps) {
+    for(uint32_t k = 0; k + 1 < steps.size(); k++) steps[k].next.assign(1, k + 1);
+    steps.back().sink = 0;
+}
+
+/**
+ * Scan the sources into the first step, then flush what every step still holds (a step comes
+ * before the steps it feeds).
+ * @param sources Sources to evaluate the path from, ascending.
+ */
+void PathPipeline::run(ArrayView<uint32_t> sources) {
+
+    std::vector<Pair> batch;
+    batch.reserve(BATCH_SIZE);
+    for(auto source : sources) {
+        batch.push_back({source, source});
+        if(batch.size() == BATCH_SIZE) {
+            push(0, batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    if(!batch.empty()) push(0, batch.data(), batch.size());
+
+    for(size_t k = 0; k < steps.size(); k++) {
+        endSource(k);
+        states[k].source = NO_SOURCE;
+        flush(k);
+    }
+}
+
+/**
+ * Expand a batch of pairs over the operand of a step.
+ * @param k The step.
+ * @param pairs Input pairs, grouped by source.
+ * @param n Number of pairs.
+ */
+void PathPipeline::push(size_t k, const Pair *pairs, size_t n) {
+    const auto &step = steps[k];
+    auto &st = states[k];
+
+    for(size_t i = 0; i < n; i++) {
+        auto p = pairs[i];
+        if(p.source != st.source) {
+            endSource(k);
+            st.source = p.source;
+            st.seen.clear(step.closure ? step.closure->getNoComponents() : noVertices);
+        }
+
+        if(step.closure) {
+            // every vertex is in one component, so distinct components give distinct targets
+            const auto &closure = *step.closure;
+            for(auto c : closure.reachable(closure.component(p.target))) {
+                if(!st.seen.insert(c)) continue;
+                for(auto member : closure.componentMembers(c)) emit(k, p.source, member);
+            }
+        } else if(st.bits) {
+            const auto &r = *step.relations[0];
+            auto row = r.find(p.target);
+            if(row == Relation::NO_ROW) continue;
+            if(!st.any) std::fill(st.acc.get(), st.acc.get() + r.getStride(), 0);
+            BitMatrix::orInto(st.acc.get(), r.bitsAt(row), r.getStride());
+            st.any = true;
+        } else {
+            for(const auto &r : step.relations) {
+                auto row = r->find(p.target);
+                if(row == Relation::NO_ROW) continue;
+                for(auto target : r->targetsAt(row)) {
+                    if(st.seen.insert(target)) emit(k, p.source, target);
+                }
+            }
+        }
+    }
+}
+
+void PathPipeline::emit(size_t k, uint32_t source, uint32_t target) {
+    auto &st = states[k];
+
+    // a sink collects the targets of its source for the counter (a BITS sink counts the bits instead)
+    if(steps[k].sink != NO_SINK && !st.bits) st.row.push_back(target);
+    if(steps[k].next.empty()) return;
+
+    st.out.push_back({source, target});
+    if(st.out.size() == BATCH_SIZE) flush(k);
+}
+
+// push the pending output of a step into every step it feeds
+void PathPipeline::flush(size_t k) {
+    auto &out = states[k].out;
+    if(out.empty()) return;
+    for(auto next : steps[k].next) push(next, out.data(), out.size());
+    out.clear();
+}
+
+/**
+ * The current source of a step is complete: a sink counts the targets it collected (a step in BITS
+ * layout its bits, without listing them), a step in BITS layout emits its targets to the steps it feeds.
+ * @param k The step.
+ */
+void PathPipeline::endSource(size_t k) {
+    auto &st = states[k];
+    const auto &step = steps[k];
+    if(step.sink != NO_SINK && !st.bits) {
+        if(!st.row.empty()) counters[step.sink].addSource(st.row.begin(), st.row.end());
+        st.row.clear();
+    }
+    if(!st.any) return;
+    st.any = false;
+
+    auto stride = step.relations[0]->getStride();
+    if(step.sink != NO_SINK) counters[step.sink].addSourceBits(st.acc.get(), stride);
+    if(step.next.empty()) return;
+    for(size_t w = 0; w < stride; w++) {
+        for(uint64_t word = st.acc[w]; word != 0; word &= word - 1) {
+            emit(k, st.source, (uint32_t) (w * 64 + __builtin_ctzll(word)));
+        }
+    }
+}
+
+std::vector<uint32_t> PathPipeline::sourcesOf(const Step &step, uint32_t noVertices) {
+    std::vector<uint32_t> sources;
+    if(step.closure) {
+        for(uint32_t vertex = 0; vertex < noVertices; vertex++) {
+            if(step.closure->getNoReachable(step.closure->component(vertex)) > 0) sources.push_back(vertex);
+        }
+        return sources;
+    }
+
+    for(const auto &r : step.relations) sources.insert(sources.end(), r->sources().begin(), r->sources().end());
+    if(step.relations.size() > 1) {
+        std::sort(sources.begin(), sources.end());
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    }
+    return sources;
+}
@@ -0,0 +1,132 @@
+#include "PathSampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Follow a path from one vertex, breadth first per entry (a closure entry keeps expanding from what it
+ * reaches until nothing new is reached).
+ * @param start Start vertex.
+ * @param path The path.
+ * @param limit Edge visits the probe may spend.
+ * @param p Scratch; receives the distinct vertices reached in p.frontier and the edges visited in p.work.
+ * @return false if the probe ran out of edge visits.
+ */
+bool PathSampler::follow(uint32_t start, const std::vector<PathEntry> &path, uint64_t limit, Probe &p) const {
+
+    auto noVertices = graph->getNoVertices();
+    p.work = 0;
+    p.frontier.assign(1, start);
+
+    auto expand = [&](uint32_t vertex, const PathEntry &pe) {
+        for(auto labelDir : pe.labels) {
+            auto targets = (labelDir.reverse ? graph->POS : graph->PSO).neighbours(labelDir.label, vertex);
+            p.work += targets.size();
+            for(auto target : targets) {
+                if(p.visited.insert(target)) p.next.push_back(target);
+            }
+        }
+    };
+
+    for(const auto &pe : path) {
+        p.visited.clear(noVertices);
+        p.next.clear();
+        for(auto vertex : p.frontier) expand(vertex, pe);
+        if(pe.kleene) {
+            for(size_t i = 0; i < p.next.size() && p.work <= limit; i++) expand(p.next[i], pe);
+        }
+        if(p.work > limit) return false;
+
+        p.frontier.swap(p.next);
+        if(p.frontier.empty()) break;
+    }
+    return true;
+}
+
+/**
+ * Probe a path from uniformly drawn sources of its first entry until the edge visits run out.
+ * A probe that does not fit in what is left ends the sample.
+ * @param path The path.
+ * @param limit Edge visits all probes may spend.
+ * @param s Receives the outcome.
+ * @return false if no probe fit.
+ */
+bool PathSampler::sample(const std::vector<PathEntry> &path, uint64_t limit, Sample &s) const {
+
+    // the sources of the first entry, read straight from the index unless it is a union
+    std::vector<uint32_t> merged;
+    ArrayView<uint32_t> starts;
+    const auto &first = path.front();
+    if(first.labels.size() == 1) {
+        auto labelDir = first.labels[0];
+        starts = (labelDir.reverse ? graph->POS : graph->PSO).sources(labelDir.label);
+    } else {
+        for(auto labelDir : first.labels) {
+            auto sources = (labelDir.reverse ? graph->POS : graph->PSO).sources(labelDir.label);
+            merged.insert(merged.end(), sources.begin(), sources.end());
+        }
+        std::sort(merged.begin(), merged.end());
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        starts = merged;
+    }
+
+    s = {};
+    s.noStarts = starts.size();
+    if(starts.empty()) return true;
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, starts.size() - 1);
+    thread_local Probe p;
+    for(uint64_t spent = 0; spent < limit;) {
+        if(!follow(starts[pick(rng)], path, limit - spent, p)) break;
+        spent += p.work + 1;
+        s.noProbes++;
+        s.noReaching += !p.frontier.empty();
+        s.noReached += p.frontier.size();
+    }
+    return s.noProbes > 0;
+}
+
+bool PathSampler::estimate(const Triple &q, cardStat &out) const {
+
+    if(q.path.empty()) return false;
+    auto noVertices = graph->getNoVertices();
+    thread_local Probe p;
+
+    // a bound endpoint is probed exactly, from the source or (reversed) from the target
+    if(q.src != NO_IDENTIFIER || q.trg != NO_IDENTIFIER) {
+        bool fromSource = q.src != NO_IDENTIFIER;
+        auto from = fromSource ? q.src : q.trg;
+        if(from >= noVertices) {
+            out = cardStat {0, 0, 0};
+            return true;
+        }
+        if(!follow(from, fromSource ? q.path : q.reversed().path, budget, p)) return false;
+
+        uint32_t n = (uint32_t) p.frontier.size();
+        if(fromSource && q.trg != NO_IDENTIFIER) {
+            n = std::find(p.frontier.begin(), p.frontier.end(), q.trg) != p.frontier.end();
+            out = cardStat {n, n, n};
+        } else {
+            out = fromSource ? cardStat {n ? 1u : 0u, n, n} : cardStat {n, n, n ? 1u : 0u};
+        }
+        return true;
+    }
+
+    // half of the budget for each end
+    Sample forward, backward;
+    if(!sample(q.path, budget / 2, forward) || !sample(q.reversed().path, budget / 2, backward)) return false;
+
+    auto scale = [](const Sample &s, uint64_t count) {
+        return s.noProbes ? (double) s.noStarts * count / s.noProbes : 0.0;
+    };
+    double noOut = scale(forward, forward.noReaching);
+    double noIn = scale(backward, backward.noReaching);
+    double noPaths = (scale(forward, forward.noReached) + scale(backward, backward.noReached)) / 2;
+
+    // keep the three consistent: every source and target is on a path, no more pairs than they make up
+    noPaths = std::min(std::max({noPaths, noOut, noIn}), noOut * noIn);
+    auto round = [](double x) { return (uint32_t) std::min(std::round(x), (double) UINT32_MAX); };
+    out = cardStat {round(noOut), round(noPaths), round(noIn)};
+    return true;
+}
@@ -0,0 +1,136 @@
+#include "Relation.h"
+
+Relation::Builder::Writer::Writer(Builder &builder, size_t part) : builder(builder), part(builder.parts[part]) {
+    std::lock_guard<std::mutex> guard(builder.lock);
+    if(builder.arenas.empty()) {
+        arena = std::make_unique<Arena>();
+    } else {
+        arena = std::move(builder.arenas.back());
+        builder.arenas.pop_back();
+    }
+}
+
+Relation::Builder::Writer::~Writer() {
+    std::lock_guard<std::mutex> guard(builder.lock);
+    builder.arenas.push_back(std::move(arena));
+}
+
+/**
+ * Concatenate the rows of all parts. The target lists stay where the writers stored them, unless
+ * bit rows are smaller (see prefersBits): then they are converted and the arenas are dropped.
+ * @return The relation.
+ */
+std::shared_ptr<Relation> Relation::Builder::finish() {
+
+    uint64_t noRows = 0, noPairs = 0;
+    for(auto &part : parts) {
+        noRows += part.sources.size();
+        for(auto &row : part.rows) noPairs += row.size();
+    }
+
+    auto r = std::make_shared<Relation>(noVertices);
+    r->noPairs = noPairs;
+    r->sourcesData.reserve(noRows);
+
+    if(prefersBits(noVertices, noRows, noPairs)) {
+        r->layout = Layout::BITS;
+        r->bits = BitMatrix(noVertices, noRows);
+        size_t i = 0;
+        for(auto &part : parts) {
+            for(auto &row : part.rows) {
+                uint64_t *bits = r->bits.row(i++);
+                for(auto target : row) bits[target >> 6] |= 1ULL << (target & 63);
+            }
+        }
+        arenas.clear();
+    } else {
+        r->rows.reserve(noRows);
+        for(auto &part : parts) r->rows.insert(r->rows.end(), part.rows.begin(), part.rows.end());
+        r->arenas = std::move(arenas);
+    }
+
+    for(auto &part : parts) {
+        r->sourcesData.insert(r->sourcesData.end(), part.sources.begin(), part.sources.end());
+        part = Part();
+    }
+    r->sourceView = r->sourcesData;
+    return r;
+}
+
+std::shared_ptr<Relation> Relation::fromIndex(const AdjacencyIndex &index, uint32_t label, uint32_t noVertices) {
+    auto r = std::make_shared<Relation>(noVertices);
+    if(label >= index.getNoLabels()) return r;
+
+    uint64_t first = index.labelOffsets[label];
+    uint64_t last = index.labelOffsets[label + 1];
+    r->sourceView = {index.vertices.ptr + first, last - first};
+    r->offsetView = {index.edgeOffsets.ptr + first, last - first + 1};
+    r->indexTargets = index.targets.ptr;
+    r->noPairs = index.getNoEdges(label);
+    return r;
+}
+
+std::shared_ptr<Relation> Relation::withBitRows(uint32_t noVertices, std::vector<uint32_t> &&sources, uint64_t noPairs) {
+    auto r = std::make_shared<Relation>(noVertices);
+    r->layout = Layout::BITS;
+    r->noPairs = noPairs;
+    r->bits = BitMatrix(noVertices, sources.size());
+    r->sourcesData = std::move(sources);
+    r->sourceView = r->sourcesData;
+    return r;
+}
+
+std::shared_ptr<Relation> Relation::asLists(const std::shared_ptr<Relation> &r) {
+    if(r->layout == Layout::LISTS) return r;
+
+    auto lists = std::make_shared<Relation>(r->noVertices);
+    lists->noPairs = r->noPairs;
+    lists->sourcesData.assign(r->sourceView.begin(), r->sourceView.end());
+    lists->sourceView = lists->sourcesData;
+    lists->arenas.push_back(std::make_unique<Arena>());
+    lists->rows.reserve(r->getNoRows());
+
+    std::vector<uint32_t> row;
+    for(size_t i = 0; i < r->getNoRows(); i++) {
+        row.clear();
+        BitMatrix::appendBits(r->bitsAt(i), r->getStride(), row);
+        lists->rows.push_back(lists->arenas[0]->append(row.begin(), row.end()));
+    }
+    return lists;
+}
+
+uint64_t Relation::getNoBytes() const {
+    uint64_t n = sourcesData.size() * sizeof(uint32_t) + rows.size() * sizeof(ArrayView<uint32_t>);
+    for(auto &arena : arenas) n += arena->getNoBytes();
+    if(layout == Layout::BITS) n += (uint64_t) getNoRows() * getStride() * sizeof(uint64_t);
+    if(hasLookup.load(std::memory_order_acquire)) n += rowOf.size() * sizeof(uint32_t);
+    return n;
+}
+
+/**
+ * Build the lookup array over all vertices, once, for a relation with many rows (at least one per
+ * LOOKUP_RATIO vertices). Relations with fewer rows are searched and never get one.
+ */
+void Relation::buildLookup() const {
+    if((uint64_t) getNoRows() * LOOKUP_RATIO < noVertices) return;
+    std::call_once(lookupOnce, [this]() {
+        rowOf.assign(noVertices, UINT32_MAX);
+        for(size_t i = 0; i < getNoRows(); i++) rowOf[sourceView[i]] = (uint32_t) i;
+        hasLookup.store(true, std::memory_order_release);
+    });
+}
+
+/**
+ * Look up the row of a vertex. Relations with few rows are searched, the others get a lookup
+ * array over all vertices (at most LOOKUP_RATIO times the size of the sources).
+ * @param vertex The source vertex.
+ * @return Its row, or NO_ROW.
+ */
+size_t Relation::findSlow(uint32_t vertex) const {
+    buildLookup();
+    if(hasLookup.load(std::memory_order_acquire)) return rowOf[vertex] == UINT32_MAX ? NO_ROW : rowOf[vertex];
+
+    auto it = std::lower_bound(sourceView.begin(), sourceView.end(), vertex);
+    if(it == sourceView.end() || *it != vertex) return NO_ROW;
+    return (size_t) (it - sourceView.begin());
+}
@@ -1,7 +1,7 @@
-#include <set>
 #include "SimpleGraph.h"
 #include "SimpleEstimator.h"
 #include  <cmath>
+#include <algorithm>
 
 #define MAX_UINT32_T 0xffffffff
 
@@ -19,60 +19,16 @@ bool cmp(const std::pair<uint32_t,uint32_t> &a, const std::pair<uint32_t,uint32_
     return false;
 }
 
+void SimpleEstimator::setSampling(uint64_t budget, uint64_t seed) {
+    if(budget == 0) sampler.reset();
+    else sampler = std::make_unique<PathSampler>(graph, budget, seed);
+}
+
 void SimpleEstimator::prepare() {
-    // do your prep here
 
     // generate statistics from the graph
-//    numEdges = graph->getNoEdges();
-//    numTuples = graph->getNoDistinctEdges();
-//    numLabels = graph->getNoLabels();
-//
-//    // count: how many out-nodes, in-nodes and paths each label has
-//    std::vector<labelInfo> buffer(numLabels);
-//    for (int i = 0; i < graph->getNoVertices(); ++i) {
-//        for(auto node : graph->adj[i]){
-//            buffer[node.first].numLabelPath++;
-//            buffer[node.first].outLabelNode.insert(i);
-//            buffer[node.first].inLabelNode.insert(node.second);
-//        }
-//    }
-//
-//    labels = std::vector<std::vector<uint32_t>>(numLabels);
-//    for (int i = 0; i < numLabels; ++i) {
-//        labels[i].push_back(buffer[i].outLabelNode.size());
-//        labels[i].push_back(0);
-//        labels[i].push_back(buffer[i].inLabelNode.size());
-//    }
-//
-//    for (auto nodeGraph : graph->adj) {
-//        std::sort(nodeGraph.begin(), nodeGraph.end(), cmp);
-//        uint32_t prevTrg = 0;
-//        uint32_t prevLabel = 0;
-//        bool first = true;
-//        for (auto pair : nodeGraph) {
-//            if (first || !(prevTrg == pair.second && prevLabel == pair.first)) {
-//                first = false;
-//                prevTrg = pair.second;
-//                prevLabel = pair.first;
-//                labels[prevLabel][1]++;
-//            }
-//        }
-//    }
-//
-//    // number of distinct src nodes
-//    for(auto nodeVector : graph->adj){
-//        if(nodeVector.size() > 0){
-//            numSrc++;
-//        }
-//    }
-//
-//    // number of distinct trg nodes
-//    // reverse_adj: reversed adjacency list: trgNode->(label1, srcNode1)->(label2, srcNode2)...
-//    for(auto nodeVector : graph->reverse_adj){
-//        if(nodeVector.size() > 0){
-//            numTrg++;
-//        }
-//    }
+    catalog.build(*graph);
+    synopsis.build(*graph, catalog);
 }
 
 cardStat SimpleEstimator::estimate(Triple &q) {
@@ -88,6 +44,11 @@ cardStat SimpleEstimator::estimate(Triple &q) {
         return cardStat{0, 0, 0};
     }
 
+    // the synopsis covers single entries and pairs, longer paths and closures are sampled (if sampling is on)
+    bool kleene = std::any_of(q.path.begin(), q.path.end(), [](const PathEntry &pe) { return pe.kleene; });
+    cardStat sampled{};
+    if(sampler != nullptr && (q.path.size() > 2 || kleene) && sampler->estimate(q, sampled)) return sampled;
+
     // if there is only one query, then no joins
     if(q.path[0].labels.size() == 1) {
         // (,>,), (,>+,), (,<,), (,<+,)
@@ -117,7 +78,7 @@ cardStat SimpleEstimator::estimate(Triple &q) {
                 trg = Union(q.path[i].labels, false);
             }
         }
-        src = concatenation(src, trg);
+        src = concatenation(src, trg, q.path[i - 1], q.path[i]);
     }
 
     estimateOnNodes(q.src, src, q.trg);
@@ -127,10 +88,19 @@ cardStat SimpleEstimator::estimate(Triple &q) {
 // estimation based on whether src and/or trg is fixed or unspecified
 void SimpleEstimator::estimateOnNodes(uint32_t src, cardStat &estimate, uint32_t trg) {
     if(src != MAX_UINT32_T && trg == MAX_UINT32_T){
+        // an empty relation (e.g. an unknown label) stays empty whatever the source
+        if(estimate.noOut == 0){
+            estimate = cardStat{0, 0, 0};
+            return;
+        }
         estimate.noPaths = ceil((float)estimate.noPaths / estimate.noOut);
         estimate.noIn = ceil((float)estimate.noIn / estimate.noOut);
         estimate.noOut = 1;
     }else if(src == MAX_UINT32_T && trg != MAX_UINT32_T){
+        if(estimate.noIn == 0){
+            estimate = cardStat{0, 0, 0};
+            return;
+        }
         estimate.noPaths = ceil((float)estimate.noPaths / estimate.noIn);
         estimate.noOut = ceil((float)estimate.noOut / estimate.noIn);
         estimate.noIn = 1;
@@ -145,50 +115,63 @@ cardStat SimpleEstimator::transClosure(std::vector<LabelDir> labels, bool kleene
 
 // (,(>|>|>|>),)
 cardStat SimpleEstimator::Union(std::vector<LabelDir> labels, bool kleene) {
-    cardStat src{0, 0, 0};
-    for (int i = 0; i < labels.size(); ++i) {
-        if(i == 0){
-            src = singleOperation(labels[i].reverse, labels[i].label, kleene);
-        }else{
-            cardStat trg = singleOperation(labels[i].reverse, labels[i].label, kleene);
-            src = unionPairwise(src, trg);
+    // a label direction named twice counts once
+    std::sort(labels.begin(), labels.end(), [](LabelDir a, LabelDir b) {
+        return a.label != b.label ? a.label < b.label : a.reverse < b.reverse;
+    });
+    labels.erase(std::unique(labels.begin(), labels.end(), [](LabelDir a, LabelDir b) {
+        return a.label == b.label && a.reverse == b.reverse;
+    }), labels.end());
+    if(labels.empty()) return cardStat{0, 0, 0};
+    if(labels.size() == 1) return singleOperation(labels[0].reverse, labels[0].label, kleene);
+
+    // the distinct sources, pairs and targets of the union from the merged sketches of its labels, every
+    // count kept between the largest of the labels' and their sum; labels all in one direction have as many
+    // distinct pairs as read forward, only both directions need the pairs as (target, source)
+    bool mixed = std::any_of(labels.begin(), labels.end(), [&](LabelDir labelDir) {
+        return labelDir.reverse != labels[0].reverse;
+    });
+    HyperLogLog sketches[3] {HyperLogLog(StatisticsCatalog::SKETCH_PRECISION), HyperLogLog(StatisticsCatalog::SKETCH_PRECISION),
+                             HyperLogLog(StatisticsCatalog::SKETCH_PRECISION)};
+    double max[3] {}, sum[3] {};
+    for(auto labelDir : labels) {
+        sketches[0].merge(catalog.sketch(labelDir.label, labelDir.reverse));
+        sketches[1].merge(catalog.pairSketch(labelDir.label, mixed && labelDir.reverse));
+        sketches[2].merge(catalog.sketch(labelDir.label, !labelDir.reverse));
+        auto single = singleOperation(labelDir.reverse, labelDir.label, kleene);
+        double counts[3] {(double) single.noOut, (double) single.noPaths, (double) single.noIn};
+        for(int i = 0; i < 3; i++) {
+            max[i] = std::max(max[i], counts[i]);
+            sum[i] += counts[i];
         }
     }
-    return src;
-}
-
-cardStat SimpleEstimator::unionPairwise(cardStat src, cardStat trg) {
-    // min:
-    cardStat smaller = src.noPaths > trg.noPaths? src : trg;
-    // max:
-    uint32_t maxPaths;
-    uint32_t maxOut;
-    uint32_t maxIn;
-    if((src.noPaths + trg.noPaths) > numTuples){
-        maxPaths = numTuples / numLabels;
-        maxOut = numSrc / numLabels;
-        maxIn = numTrg / numLabels;
-    }else{
-        maxPaths = src.noPaths + trg.noPaths;
-        maxOut = src.noOut + trg.noOut;
-        maxIn = src.noIn + trg.noIn;
+    uint32_t counts[3];
+    for(int i = 0; i < 3; i++) {
+        counts[i] = (uint32_t) std::min(std::round(std::min(std::max(sketches[i].estimate(), max[i]), sum[i])), (double) MAX_UINT32_T);
     }
-    return cardStat{(smaller.noOut + maxOut) / 2, (smaller.noPaths + maxPaths) / 2, (smaller.noIn + maxIn) / 2};
-//    return cardStat{src.noOut + trg.noIn, src.noPaths + trg.noPaths, src.noIn + trg.noIn};
+    return cardStat{counts[0], counts[1], counts[2]};
 }
 
 // deal with > and <
 cardStat SimpleEstimator::singleOperation(uint32_t reverse, uint32_t label, bool kleene) {
+    // a label the graph does not have is an empty relation
+    auto &stats = catalog.label(label);
+    auto noPaths = (uint32_t) std::min<uint64_t>(stats.noPairs, MAX_UINT32_T);
     if(reverse){
-        return cardStat{labels[label][2], labels[label][1], labels[label][0]};
+        return cardStat{stats.noTargets, noPaths, stats.noSources};
     }else{
-        return cardStat{labels[label][0], labels[label][1], labels[label][2]};
+        return cardStat{stats.noSources, noPaths, stats.noTargets};
     }
 }
 
 // join
 cardStat SimpleEstimator::concatenation(cardStat src, cardStat trg) {
-    double noPaths = std::min(src.noPaths * trg.noPaths / trg.noOut, trg.noPaths * src.noPaths / src.noIn);
+    if(src.noPaths == 0 || trg.noPaths == 0) return cardStat{0, 0, 0};
+
+    // in double: the product of two path counts easily exceeds 32 bits
+    double product = (double) src.noPaths * trg.noPaths;
+    double noPaths = std::min(product / std::max(trg.noOut, 1u), product / std::max(src.noIn, 1u));
+    noPaths = std::min(noPaths, (double) MAX_UINT32_T);
 //    uint32_t noPaths = src.noPaths * trg.noPaths / trg.noOut;
     double rf_Src = noPaths / src.noPaths;
     double rf_Trg = noPaths / trg.noPaths;
@@ -197,3 +180,38 @@ cardStat SimpleEstimator::concatenation(cardStat src, cardStat trg) {
 
     return cardStat{noOut, (uint32_t)noPaths, noIn};
 }
+
+/**
+ * Join two estimates where they meet in a single label on both sides, using the label pair synopsis:
+ * every path of src ends in an edge of last and every path of trg starts with an edge of first, so the
+ * share of (last, first) edge pairs that meet is the share of (src, trg) path pairs that do, and the share
+ * of the sources (targets) of last (first) that continue is the share of the sources of src (targets of trg)
+ * that do. Falls back to the independence assumption when the synopsis does not cover the labels.
+ * @param src Estimate of the left part of the path.
+ * @param trg Estimate of the right part of the path.
+ * @param last Last entry of the left part.
+ * @param first First entry of the right part.
+ * @return Estimate of the concatenation.
+ */
+cardStat SimpleEstimator::concatenation(cardStat src, cardStat trg, const PathEntry &last, const PathEntry &first) {
+    if(last.kleene || first.kleene || last.labels.size() != 1 || first.labels.size() != 1) return concatenation(src, trg);
+    auto pair = synopsis.pair(last.labels[0], first.labels[0]);
+    if(pair == nullptr) return concatenation(src, trg);
+    if(src.noPaths == 0 || trg.noPaths == 0 || pair->noPaths == 0) return cardStat{0, 0, 0};
+
+    auto a = singleOperation(last.labels[0].reverse, last.labels[0].label, false);
+    auto b = singleOperation(first.labels[0].reverse, first.labels[0].label, false);
+
+    // the fewer distinct vertices a side ends in compared to its label, the more it ends in the hubs that
+    // continue, so its share of continuing sources (targets) grows accordingly
+    auto share = [](double continuing, uint32_t all, uint32_t labelEnds, uint32_t ends) {
+        return std::min(1.0, continuing / std::max(all, 1u) * std::max(labelEnds, 1u) / std::max(ends, 1u));
+    };
+    double noPaths = (double) src.noPaths * trg.noPaths * pair->noPaths / ((double) a.noPaths * b.noPaths);
+    double noOut = std::min(src.noOut * share(pair->noOut, a.noOut, a.noIn, src.noIn), noPaths);
+    double noIn = std::min(trg.noIn * share(pair->noIn, b.noIn, b.noOut, trg.noOut), noPaths);
+    noPaths = std::min(noPaths, noOut * noIn);
+
+    auto round = [](double x) { return (uint32_t) std::min(std::max(std::ceil(x), 1.0), (double) MAX_UINT32_T); };
+    return cardStat{round(noOut), round(noPaths), round(noIn)};
+}
@@ -1,11 +1,47 @@
 #include "SimpleEstimator.h"
 #include "SimpleEvaluator.h"
+#include "BitMatrix.h"
+#include "CardinalityCounter.h"
+#include "CondensedClosure.h"
+#include "JoinPlanner.h"
+#include "PathPipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+namespace {
+
+    using ClosureMap = std::unordered_map<SubplanCache::Key, std::shared_ptr<CondensedClosure>, SubplanCache::KeyHash>;
+
+    // closures shared by the queries of the batch evaluated on this thread, only during evaluateBatch
+    thread_local ClosureMap *batchClosures = nullptr;
+
+    // sets batchClosures for the lifetime of a batch, and resets it however the batch ends
+    struct BatchClosuresScope {
+        explicit BatchClosuresScope(ClosureMap &closures) { batchClosures = &closures; }
+        ~BatchClosuresScope() { batchClosures = nullptr; }
+        BatchClosuresScope(const BatchClosuresScope &) = delete;
+        BatchClosuresScope &operator=(const BatchClosuresScope &) = delete;
+    };
+
+}
 
 SimpleEvaluator::SimpleEvaluator(std::shared_ptr<SimpleGraph> &g) {
 
     // works only with SimpleGraph
     graph = g;
     est = nullptr; // estimator not attached by default
+    pool = std::make_shared<ThreadPool>();
+}
+
+/**
+ * Set the number of threads used by the operators of this evaluator.
+ * @param noThreads Number of threads, 0 means one per hardware thread.
+ */
+void SimpleEvaluator::setNoThreads(uint32_t noThreads) {
+    pool = std::make_shared<ThreadPool>(noThreads);
 }
 
 void SimpleEvaluator::attachEstimator(std::shared_ptr<SimpleEstimator> &e) {
@@ -15,288 +51,924 @@ void SimpleEvaluator::attachEstimator(std::shared_ptr<SimpleEstimator> &e) {
 void SimpleEvaluator::prepare() {
 
     // if attached, prepare the estimator
-//    if(est != nullptr) est->prepare();
+    if(est != nullptr) est->prepare();
 
     // prepare other things here.., if necessary
 
 }
 
-cardStat SimpleEvaluator::computeStats(std::shared_ptr<SimpleGraph> &g) {
+cardStat SimpleEvaluator::computeStats(std::shared_ptr<Relation> &r) {
 
-    cardStat stats {};
+    CardinalityCounter counter(r->getNoVertices());
+    countGraph(r, counter);
+    return counter.result();
+}
 
-    for(int source = 0; source < g->getNoVertices(); source++) {
-        if(!g->SO[source].empty()) stats.noOut++;
+/**
+ * Select all edges from a graph with a given edge label.
+ * @param projectLabel Label to select.
+ * @param inverse Follow the edges in inverse direction.
+ * @param in The graph to select from.
+ * @return The relation of the label, a view of the CSR rows of the index (nothing is copied).
+ */
+std::shared_ptr<Relation> SimpleEvaluator::selectLabel(uint32_t projectLabel, bool inverse, std::shared_ptr<SimpleGraph> &in) {
+    return Relation::fromIndex(inverse ? in->POS : in->PSO, projectLabel, in->getNoVertices());
+}
+
+/**
+ * Transitive closure (TC) of a relation. The strongly connected components are condensed first
+ * (see CondensedClosure), so reachability is computed once per component instead of once per vertex.
+ * The size of the closure is known from the condensation, so its layout is picked before the rows are
+ * written, blocks of components are spread over the thread pool. In LISTS layout the members of a
+ * component share one row.
+ * @param base The relation to close.
+ * @return The relation base+.
+ */
+std::shared_ptr<Relation> SimpleEvaluator::transitiveClosure(std::shared_ptr<Relation> &base) {
+
+    auto noVertices = base->getNoVertices();
+    CondensedClosure closure(*Relation::asLists(base));
+
+    std::vector<uint32_t> sources;
+    uint64_t noPairs = 0;
+    for(uint32_t vertex = 0; vertex < noVertices; vertex++) {
+        uint64_t n = closure.getNoReachable(closure.component(vertex));
+        if(n == 0) continue;
+        sources.push_back(vertex);
+        noPairs += n;
     }
 
-    stats.noPaths = g->getNoDistinctEdges();
+    if(Relation::prefersBits(noVertices, sources.size(), noPairs)) {
+        auto out = Relation::withBitRows(noVertices, std::move(sources), noPairs);
+        pool->parallelFor(0, out->getNoRows(), 256, [&](uint64_t first, uint64_t last) {
+            for(auto i = first; i < last; i++) {
+                uint64_t *bits = out->mutableBits(i);
+                for(auto c : closure.reachable(closure.component(out->sourceAt(i)))) {
+                    for(auto vertex : closure.componentMembers(c)) bits[vertex >> 6] |= 1ULL << (vertex & 63);
+                }
+            }
+        });
+        return out;
+    }
 
-    for(auto trg : g->trgBitMap){
-        if(trg) stats.noIn++;
+    // all members of a component share one stored row
+    Relation::Builder builder(noVertices, 1);
+    std::vector<ArrayView<uint32_t>> rows(closure.getNoComponents());
+    pool->parallelFor(0, closure.getNoComponents(), 256, [&](uint64_t first, uint64_t last) {
+        Relation::Builder::Writer writer(builder, 0);
+        std::vector<uint32_t> row;
+        for(auto c = (uint32_t) first; c < last; c++) {
+            if(closure.reachable(c).empty()) continue;
+            closure.row(c, row);
+            rows[c] = writer.store(row.begin(), row.end());
+        }
+    });
+    {
+        Relation::Builder::Writer writer(builder, 0);
+        for(auto vertex : sources) writer.add(vertex, rows[closure.component(vertex)]);
     }
+    return builder.finish();
+}
 
-    return stats;
+/**
+ * Union of two relations, used for computation of kleene star.
+ * The sources of both relations are merged, and the rows of a source present in both are merged too.
+ * @param left A relation to be merged.
+ * @param right A relation to be merged.
+ * @return A new relation with the distinct pairs of both.
+ */
+std::shared_ptr<Relation> SimpleEvaluator::unionDistinct(std::shared_ptr<Relation> &left, std::shared_ptr<Relation> &right) {
+
+    Relation::Builder builder(left->getNoVertices(), 1);
+    {
+        Relation::Builder::Writer writer(builder, 0);
+        std::vector<uint32_t> leftScratch, rightScratch, merged;
+
+        size_t i = 0, j = 0;
+        while(i < left->getNoRows() || j < right->getNoRows()) {
+            uint32_t source = std::min(i < left->getNoRows() ? left->sourceAt(i) : UINT32_MAX,
+                                       j < right->getNoRows() ? right->sourceAt(j) : UINT32_MAX);
+            ArrayView<uint32_t> l, r;
+            if(i < left->getNoRows() && left->sourceAt(i) == source) l = left->row(i++, leftScratch);
+            if(j < right->getNoRows() && right->sourceAt(j) == source) r = right->row(j++, rightScratch);
+
+            merged.clear();
+            std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(merged));
+            writer.add(source, merged.begin(), merged.end());
+        }
+    }
+    return builder.finish();
 }
 
 /**
- * Select all edges from a graph with a given edge label.
- * @param projectLabel Label to select.
- * @param outLabel Label to rename the selected edge labels to (used in the TC).
- * @param inverse Follow the edges in inverse direction.
- * @param in The graph to select from.
- * @return The graph which only has edges with the specified edge label.
+ * Join (compose) two relations. The rows of the left relation are split into blocks that the thread pool
+ * spreads (and steals) over its threads, every block builds the rows of its own sources into a part of
+ * the output, so the output needs no locking. Right inputs in LISTS layout are joined list by list,
+ * duplicate targets of a source are dropped while joining: a per-thread set of the targets reached by the
+ * current source makes every candidate edge an O(1) check. Right inputs in BITS layout are joined as a
+ * boolean matrix product (see BitMatrix).
+ * @param left A relation to be joined.
+ * @param right Another relation to join with.
+ * @return The relation left/right.
  */
-std::shared_ptr<SimpleGraph> SimpleEvaluator::selectLabel(uint32_t projectLabel, uint32_t outLabel, bool inverse, std::shared_ptr<SimpleGraph> &in) {
-
-    auto out = std::make_shared<SimpleGraph>(in->getNoVertices());
-    out->setNoLabels(in->getNoLabels());
-    if(!inverse){
-        auto buffer = in->PSO[projectLabel];
-        for(auto pairs : buffer){
-            if(!out->edgeExists(pairs.first, pairs.second, outLabel)) {
-                out->addEdge(pairs.first, pairs.second, outLabel);
+std::shared_ptr<Relation> SimpleEvaluator::join(std::shared_ptr<Relation> &left, std::shared_ptr<Relation> &right) {
+
+    const uint64_t grain = 64;
+    Relation::Builder builder(left->getNoVertices(), (left->getNoRows() + grain - 1) / grain);
+
+    if(right->getLayout() == Relation::Layout::BITS) {
+        auto stride = right->getStride();
+
+        pool->parallelFor(0, left->getNoRows(), grain, [&](uint64_t first, uint64_t last) {
+            Relation::Builder::Writer writer(builder, first / grain);
+            auto acc = BitMatrix::allocateWords(stride);
+            std::vector<uint32_t> scratch, row;
+
+            for(auto i = first; i < last; i++) {
+                bool any = false;
+                for(auto target : left->row(i, scratch)) {
+                    auto r = right->find(target);
+                    if(r == Relation::NO_ROW) continue;
+                    if(!any) std::fill(acc.get(), acc.get() + stride, 0);
+                    BitMatrix::orInto(acc.get(), right->bitsAt(r), stride);
+                    any = true;
+                }
+                if(!any) continue;
+
+                row.clear();
+                BitMatrix::appendBits(acc.get(), stride, row);
+                writer.add(left->sourceAt(i), row.begin(), row.end());
             }
-        }
-    }else{
-        auto buffer = in->POS[projectLabel];
-        for(auto pairs : buffer){
-            if(!out->edgeExists(pairs.first, pairs.second, outLabel)) {
-                out->addEdge(pairs.first, pairs.second, outLabel);
+        });
+    } else {
+        pool->parallelFor(0, left->getNoRows(), grain, [&](uint64_t first, uint64_t last) {
+            Relation::Builder::Writer writer(builder, first / grain);
+            thread_local VisitedSet seen;
+            std::vector<uint32_t> scratch, row;
+
+            for(auto i = first; i < last; i++) {
+                // try to join the left targets with right s
+                seen.clear(right->getNoVertices());
+                row.clear();
+                for(auto target : left->row(i, scratch)) {
+                    auto r = right->find(target);
+                    if(r == Relation::NO_ROW) continue;
+                    for(auto rightTarget : right->targetsAt(r)) {
+                        if(seen.insert(rightTarget)) row.push_back(rightTarget);
+                    }
+                }
+
+                std::sort(row.begin(), row.end());
+                writer.add(left->sourceAt(i), row.begin(), row.end());
             }
-        }
+        });
     }
 
-    return out;
+    return builder.finish();
 }
 
 /**
- * A SMART transitive closure (TC) computation.
- * @param in Input graph
- * @return
+ * Evaluate a single path entry: a label, a union of labels or the closure of either. A label is a view of
+ * the index, unions and closures go through the sub-plan cache.
+ * @param pe The path entry.
+ * @return Solution as a relation.
  */
-std::shared_ptr<SimpleGraph> SimpleEvaluator::transitiveClosure(std::shared_ptr<SimpleGraph> &base) {
+std::shared_ptr<Relation> SimpleEvaluator::evaluateUnionKleene(const PathEntry &pe) {
 
-    auto out = std::make_shared<SimpleGraph>(base);
-    auto delta = std::make_shared<SimpleGraph>(base);
+    if(!pe.kleene && pe.labels.size() == 1) {
+        // base label selection
+        auto labelDir = pe.labels[0];
+        return selectLabel(labelDir.label, labelDir.reverse, graph);
+    }
 
-    uint32_t numNewAdded = 1;
-    while (numNewAdded) {
-        delta = join(delta, out);
-        numNewAdded = unionDistinctTC(out, delta);
+    auto key = SubplanCache::keyOf(&pe, &pe + 1);
+    auto out = cache.find(key);
+    if(out) return out;
+
+    auto start = std::chrono::steady_clock::now();
+    if(pe.kleene) {
+        // evaluate closure
+        PathEntry inner = pe;
+        inner.kleene = false;
+        auto base = evaluateUnionKleene(inner);
+        out = transitiveClosure(base);
+    } else {
+        // (left-deep) union
+        out = selectLabel(pe.labels[0].label, pe.labels[0].reverse, graph);
+        for(size_t i = 1; i < pe.labels.size(); i++) {
+            auto right = selectLabel(pe.labels[i].label, pe.labels[i].reverse, graph);
+            out = unionDistinct(out, right);
+        }
     }
+    auto end = std::chrono::steady_clock::now();
 
+    cache.insert(key, out, std::chrono::duration<double, std::nano>(end - start).count());
     return out;
 }
 
 /**
- * Merges a graph into another graph, used for computation of kleene star.
- * @param left A graph to be merged into.
- * @param right A graph to be merged from.
- * @return A number of distinct new edges added from the "right" graph into the "left" graph.
+ * Set the memory the sub-plan cache may hold.
+ * @param bytes Budget in bytes.
  */
-std::shared_ptr<SimpleGraph> SimpleEvaluator::unionDistinct(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right) {
+void SimpleEvaluator::setCacheBudget(uint64_t bytes) {
+    cache.setBudget(bytes);
+}
 
-    for(uint32_t source = 0; source < right->getNoVertices(); source++) {
-        for (auto target : right->SO[source]) {
+void SimpleEvaluator::setJoinOrder(JoinOrder order) {
+    joinOrder = order;
+}
 
-            if(!left->edgeExists(source, target, 0)) {
-                left->addEdge(source, target, 0);
-            }
-        }
-    }
-    return left;
+void SimpleEvaluator::setApproximate(bool on) {
+    approximate = on;
+}
+
+double SimpleEvaluator::getRelativeError() const {
+    return approximate ? HyperLogLog::relativeError(HyperLogLog::DEFAULT_PRECISION) : 0;
 }
 
 /**
- * Merges a graph into another graph, used for transitive closure.
- * @param left A graph to be merged into.
- * @param right A graph to be merged from.
- * @return A number of distinct new edges added from the "right" graph into the "left" graph.
+ * Choose the join order of a concatenation.
+ * @param path The concatenation.
+ * @return The cheapest plan according to the estimator, or the textual (left-deep) order when
+ * no estimator is attached or the textual order was asked for.
  */
-uint32_t SimpleEvaluator::unionDistinctTC(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right) {
+JoinPlan SimpleEvaluator::planJoins(const std::vector<PathEntry> &path) {
+    if(joinOrder == JoinOrder::PLANNED && est != nullptr) return JoinPlanner::plan(*est, path);
+    return JoinPlan::leftDeep((uint32_t) path.size());
+}
 
-    uint32_t numNewAdded = 0;
+/**
+ * Given an AST, evaluate the query and produce an answer relation.
+ * @param path Parsed AST (a concatenation).
+ * @return Solution as a relation.
+ */
+std::shared_ptr<Relation> SimpleEvaluator::evaluateConcat(const std::vector<PathEntry> &path) {
+    auto plan = planJoins(path);
+    return evaluatePlan(path, plan, 0, (uint32_t) path.size() - 1);
+}
 
-    auto newDelta = std::make_shared<SimpleGraph>(left->getNoVertices());
+/**
+ * Evaluate the sub-path [i, j] of a concatenation in the order given by a plan.
+ * Joined sub-paths go through the sub-plan cache, their key does not depend on the order they were joined in.
+ * @param path The concatenation.
+ * @param plan Join order.
+ * @param i First entry of the sub-path.
+ * @param j Last entry of the sub-path.
+ * @return Solution as a relation.
+ */
+std::shared_ptr<Relation> SimpleEvaluator::evaluatePlan(const std::vector<PathEntry> &path, const JoinPlan &plan, uint32_t i, uint32_t j) {
+    if(i == j) return evaluateUnionKleene(path[i]);
 
-    for(uint32_t source = 0; source < right->getNoVertices(); source++) {
-        for (auto target : right->SO[source]) {
+    auto key = SubplanCache::keyOf(path.data() + i, path.data() + j + 1);
+    auto out = cache.find(key);
+    if(out) return out;
 
-            if(!left->edgeExists(source, target, 0)) {
-                left->addEdge(source, target, 0);
-                newDelta->addEdge(source, target, 0);
-                numNewAdded++;
-            }
+    auto start = std::chrono::steady_clock::now();
+    auto left = evaluatePlan(path, plan, i, plan.split(i, j));
+    auto right = evaluatePlan(path, plan, plan.split(i, j) + 1, j);
+    out = join(left, right);
+    auto end = std::chrono::steady_clock::now();
+
+    cache.insert(key, out, std::chrono::duration<double, std::nano>(end - start).count());
+    return out;
+}
+
+/**
+ * Count a (materialized) relation.
+ * @param r The relation.
+ * @param counter Sink for the answer.
+ */
+void SimpleEvaluator::countGraph(std::shared_ptr<Relation> &r, CardinalityCounter &counter) {
+    auto count = [&](size_t row) {
+        if(r->getLayout() == Relation::Layout::BITS) {
+            counter.addSourceBits(r->bitsAt(row), r->getStride());
+        } else {
+            auto targets = r->targetsAt(row);
+            counter.addSource(targets.begin(), targets.end());
         }
+    };
+
+    for(size_t row = 0; row < r->getNoRows(); row++) count(row);
+}
+
+/**
+ * The condensed closure of a Kleene path entry, kept in the sub-plan cache across queries. During
+ * evaluateBatch a closure is also held for the whole batch, so it is condensed once even if the cache
+ * evicts it.
+ * @param pe The path entry.
+ * @return Its closure.
+ */
+std::shared_ptr<CondensedClosure> SimpleEvaluator::closureOf(const PathEntry &pe) {
+
+    auto key = SubplanCache::condensedKeyOf(pe);
+    if(batchClosures != nullptr) {
+        auto it = batchClosures->find(key);
+        if(it != batchClosures->end()) return it->second;
     }
 
-    right = newDelta;
+    auto closure = cache.findClosure(key);
+    if(!closure) {
+        auto start = std::chrono::steady_clock::now();
+        PathEntry inner = pe;
+        inner.kleene = false;
+        auto base = evaluateUnionKleene(inner);
+        closure = std::make_shared<CondensedClosure>(*Relation::asLists(base));
+        auto end = std::chrono::steady_clock::now();
 
-    return numNewAdded;
+        cache.insert(key, closure, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    if(batchClosures != nullptr) (*batchClosures)[key] = closure;
+    return closure;
 }
 
+/**
+ * The operand of a path entry in a pipeline. Labels are views of the index and a closure stays
+ * condensed, so neither is materialized.
+ * @param pe The path entry.
+ * @return The pipeline step of the entry.
+ */
+PathPipeline::Step SimpleEvaluator::pipelineStep(const PathEntry &pe) {
+    PathPipeline::Step step;
+    if(pe.kleene) {
+        step.closure = closureOf(pe);
+    } else {
+        for(auto labelDir : pe.labels) step.relations.push_back(selectLabel(labelDir.label, labelDir.reverse, graph));
+    }
+    return step;
+}
 
 /**
- * Implementation of a join in transitive closure, the same as the default join(), may be removed if the joins in TC can be cached.
- * @param left A graph to be joined.
- * @param right Another graph to join with.
- * @return Answer graph for a join. Note that all labels in the answer graph are "0".
+ * Count a concatenation through a PathPipeline along the left spine of its join plan: the leftmost
+ * entry is scanned, every right child of the spine is a step. A right child of one entry is expanded
+ * straight from its operand, a longer one is a pipeline breaker and is materialized by evaluatePlan.
+ * @param path The concatenation (at least two entries).
+ * @param plan Join order.
+ * @param counter Sink for the answer.
  */
-std::shared_ptr<SimpleGraph> SimpleEvaluator::join(std::shared_ptr<SimpleGraph> &left, std::shared_ptr<SimpleGraph> &right) {
+void SimpleEvaluator::countPipelined(const std::vector<PathEntry> &path, const JoinPlan &plan, CardinalityCounter &counter) {
 
-    auto out = std::make_shared<SimpleGraph>(left->getNoVertices());
-    out->setNoLabels(1);
+    auto n = (uint32_t) path.size();
+    std::vector<std::pair<uint32_t, uint32_t>> spine; // right children, outermost first
+    for(uint32_t j = n - 1; j > 0; j = plan.split(0, j)) spine.emplace_back(plan.split(0, j) + 1, j);
 
-    for(uint32_t leftSource = 0; leftSource < left->getNoVertices(); leftSource++) {
-        for (auto target : left->SO[leftSource]) {
+    std::vector<PathPipeline::Step> steps;
+    steps.push_back(pipelineStep(path[0]));
+    for(auto it = spine.rbegin(); it != spine.rend(); ++it) {
+        if(it->first == it->second) {
+            steps.push_back(pipelineStep(path[it->first]));
+        } else {
+            PathPipeline::Step step;
+            step.relations.push_back(evaluatePlan(path, plan, it->first, it->second));
+            steps.push_back(step);
+        }
+    }
 
-            // try to join the left target with right s
-            for (auto rightLabelTarget : right->SO[target]) {
+    PathPipeline::chain(steps);
+    countSteps(steps, {&counter});
+}
 
-                auto rightTarget = rightLabelTarget;
-                out->addEdge(leftSource, rightTarget, 0);
+/**
+ * Count the answers of a pipeline. Blocks of sources are spread over the thread pool, each with a pipeline
+ * (reused by the next block on any thread) that counts into its own partial counters; the partial
+ * counters are merged at the end.
+ * @param steps The steps of the pipeline (at least one).
+ * @param counters Sink for the answer of every sink step.
+ */
+void SimpleEvaluator::countSteps(const std::vector<PathPipeline::Step> &steps, const std::vector<CardinalityCounter *> &counters) {
 
-            }
-        }
-    }
+    auto sources = PathPipeline::sourcesOf(steps[0], graph->getNoVertices());
+    std::vector<CardinalityCounter> empty;
+    for(auto counter : counters) empty.push_back(counter->emptyLike());
 
-    return out;
+    auto pipelines = pool->parallelForPartials(0, sources.size(), 256, [&]() {
+        return std::make_unique<PathPipeline>(steps, graph->getNoVertices(), empty);
+    }, [&](PathPipeline &pipeline, uint64_t first, uint64_t last) {
+        pipeline.run({sources.data() + first, last - first});
+    });
+
+    for(auto &pipeline : pipelines) {
+        for(uint32_t sink = 0; sink < counters.size(); sink++) counters[sink]->merge(pipeline->getCounter(sink));
+    }
 }
 
-std::shared_ptr<SimpleGraph> SimpleEvaluator::evaluateUnionKleene(PathEntry &pe) {
+/**
+ * Count a non-Kleene path entry (a label or a union of labels) straight from the indexes.
+ * @param pe The path entry.
+ * @param counter Sink for the answer.
+ */
+void SimpleEvaluator::countLabels(const PathEntry &pe, CardinalityCounter &counter) {
+
+    auto indexOf = [&](LabelDir labelDir) -> const AdjacencyIndex & {
+        return labelDir.reverse ? graph->POS : graph->PSO;
+    };
+
+    // a single label: the CSR rows already are the answer
+    if(pe.labels.size() == 1) {
+        auto labelDir = pe.labels[0];
+        const auto &index = indexOf(labelDir);
+        for(size_t i = 0; i < index.sources(labelDir.label).size(); i++) {
+            auto targets = index.neighboursAt(index.labelOffsets[labelDir.label] + i);
+            counter.addSource(targets.begin(), targets.end());
+        }
+        return;
+    }
 
-    if(pe.kleene) {
-        // evaluate closure
-        pe.kleene = false;
-        auto base = evaluateUnionKleene(pe);
-        return transitiveClosure(base);
-    } else {
-        // not Kleene
-        if (pe.labels.size() == 1) {
-            // base label selection
-            auto labelDir = pe.labels[0];
-            return selectLabel(labelDir.label, 0, labelDir.reverse, graph);
-        } else {
-            // (left-deep) union
-            std::shared_ptr<SimpleGraph> out;
-            std::string query = std::to_string(pe.labels[0].label);
-            for (int i = 1; i < pe.labels.size(); i++) {
-                query += "|" + std::to_string(pe.labels[i].label);
-                if(unionCache.count(query) > 0){
-                    out = unionCache[query];
-                }else{
-                    auto right = selectLabel(pe.labels[i].label, 0, pe.labels[0].reverse, graph);
-                    if(i == 1){
-                        auto left = selectLabel(pe.labels[0].label, 0, pe.labels[0].reverse, graph);
-                        out = unionDistinct(left, right);
-                    }else{
-                        out = unionDistinct(out, right);
-                    }
-                    unionCache[query] = out;
+    std::vector<uint32_t> sources;
+    for(auto labelDir : pe.labels) {
+        auto labelSources = indexOf(labelDir).sources(labelDir.label);
+        sources.insert(sources.end(), labelSources.begin(), labelSources.end());
+    }
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+    std::vector<uint32_t> seenBy(graph->getNoVertices(), NO_IDENTIFIER);
+    std::vector<uint32_t> row;
+    for(auto s : sources) {
+        row.clear();
+        for(auto labelDir : pe.labels) {
+            for(auto target : indexOf(labelDir).neighbours(labelDir.label, s)) {
+                if(seenBy[target] != s) {
+                    seenBy[target] = s;
+                    row.push_back(target);
                 }
             }
-            return out;
         }
+        counter.addSource(row.begin(), row.end());
     }
 }
 
 /**
- * Given an AST, evaluate the query and produce an answer graph.
- * @param q Parsed AST.
- * @return Solution as a graph.
+ * Follow one path entry (without its Kleene closure) from a set of vertices.
+ * @param frontier Distinct start vertices.
+ * @param pe Path entry whose labels are followed.
+ * @param visited Set of vertices already in "next"; new vertices are added to it.
+ * @param next Receives the distinct vertices reached.
  */
-std::shared_ptr<SimpleGraph> SimpleEvaluator::evaluateConcat(std::vector<PathEntry> &path, std::string query) {
-    auto out  = evaluateUnionKleene(path[0]);
-    // evaluate according to the AST top-down
-    // 1. evaluate concatenations
-    std::string subquery;
-    if(path.size() > 1) {
-        query = query.substr (query.find(",") + 1, query.rfind(",") - 2);
-        uint32_t slash = query.find("/");
-        slash = query.find("/", slash + 1);
-        if(slash > query.length()){
-            subquery = query;
-            query = "";
-        }else{
-            subquery = query.substr (0, slash);
-            query = query.substr(slash + 1);
-        }
-        // (left-deep) join
-        for(int i = 1; i < path.size(); i++) {
-            if(joinCache.count(subquery) > 0){
-                out = joinCache[subquery];
-            }else{
-                auto rg  = evaluateUnionKleene(path[i]);
-                out = join(out, rg);
-                joinCache[subquery] = out;
-            }
-            slash = query.find("/");
-            if(!query.empty()){
-                if(slash > query.length()){
-                    subquery += query;
-                    query = "";
-                }else{
-                    subquery += query.substr (0, slash);
-                    query = query.substr(slash + 1);
-                }
+void SimpleEvaluator::expandFrontier(const std::vector<uint32_t> &frontier, const PathEntry &pe,
+                                     VisitedSet &visited, std::vector<uint32_t> &next) {
+    for(auto vertex : frontier) {
+        for(auto labelDir : pe.labels) {
+            const auto &index = labelDir.reverse ? graph->POS : graph->PSO;
+            for(auto target : index.neighbours(labelDir.label, vertex)) {
+                if(visited.insert(target)) next.push_back(target);
             }
         }
-        return out;
     }
-    return out;
 }
 
 /**
- * Perform a selection on a source constant.
- * @param s A source constant.
- * @param in A graph to select from.
- * @return An answer graph as a result of the given selection.
+ * Follow one path entry, including its Kleene closure, from a set of vertices.
+ * @param frontier Distinct start vertices.
+ * @param pe Path entry to follow.
+ * @param visited Set of vertices already in "next"; new vertices are added to it.
+ * @param next Receives the distinct vertices reached.
  */
-std::shared_ptr<SimpleGraph> selectSource(Identifier &s, std::shared_ptr<SimpleGraph> &in) {
+void SimpleEvaluator::expandEntry(const std::vector<uint32_t> &frontier, const PathEntry &pe,
+                                  VisitedSet &visited, std::vector<uint32_t> &next) {
+    expandFrontier(frontier, pe, visited, next);
+    if(!pe.kleene) return;
+
+    // vertices reachable in one or more steps: keep expanding what was newly reached
+    std::vector<uint32_t> single(1);
+    for(size_t i = 0; i < next.size(); i++) {
+        single[0] = next[i];
+        expandFrontier(single, pe, visited, next);
+    }
+}
 
-    auto out = std::make_shared<SimpleGraph>(in->getNoVertices());
-    out->setNoLabels(in->getNoLabels());
+/**
+ * Evaluate a path from a single source vertex outward. Every step expands only the current frontier,
+ * a Kleene step becomes a reachability search from the frontier, so the cost depends on the part of the
+ * graph reachable from the source rather than on the whole graph.
+ * @param source Bound source vertex.
+ * @param path Path to follow.
+ * @return The distinct vertices reachable from the source over the path.
+ */
+std::vector<uint32_t> SimpleEvaluator::evaluateFrom(uint32_t source, const std::vector<PathEntry> &path) {
+
+    std::vector<uint32_t> frontier, next;
+    if(source >= graph->getNoVertices()) return frontier;
+    frontier.push_back(source);
+
+    thread_local VisitedSet visited;
+    for(const auto &pe : path) {
+        visited.clear(graph->getNoVertices());
+        next.clear();
+        expandEntry(frontier, pe, visited, next);
+        frontier.swap(next);
+        if(frontier.empty()) break;
+    }
 
-    for (auto labelTarget : in->SO[s]) {
+    return frontier;
+}
 
-        auto target = labelTarget;
+/**
+ * Decide whether to evaluate a concatenation from both ends, and where the two halves meet. The pipeline
+ * produces every prefix [0, j] of the path; meeting at m produces the prefixes [0, j < m] forward, the
+ * suffixes [j >= m, n - 1] backward and the answer where they meet, after two passes over the edges
+ * that can be reached from either end (see matchVertices) and a scan of the n + 1 vertex bitsets these
+ * leave. Both costs are the sum of the estimated sizes
+ * of what they produce or touch, so the halves meet where the path is narrowest. Paths with a closure are
+ * left to the pipeline, which keeps closures condensed instead of searching them from every vertex.
+ * @param path The concatenation.
+ * @return The first entry of the backward half, or 0 if the pipeline is expected to be cheaper (or
+ * there is no estimator to tell).
+ */
+uint32_t SimpleEvaluator::chooseMiddle(const std::vector<PathEntry> &path) {
 
-        out->addEdge(s, target, 0);
+    auto n = (uint32_t) path.size();
+    if(n < 3 || est == nullptr || joinOrder != JoinOrder::PLANNED) return 0;
+    for(const auto &pe : path) {
+        if(pe.kleene) return 0;
     }
 
-    return out;
+    std::vector<cardStat> single(n), prefix(n), suffix(n);
+    for(uint32_t i = 0; i < n; i++) {
+        Triple entry {NO_IDENTIFIER, {path[i]}, NO_IDENTIFIER};
+        single[i] = est->estimate(entry);
+    }
+    prefix[0] = single[0];
+    for(uint32_t i = 1; i < n; i++) prefix[i] = est->concatenation(prefix[i - 1], single[i], path[i - 1], path[i]);
+    suffix[n - 1] = single[n - 1];
+    for(uint32_t i = n - 1; i-- > 0;) suffix[i] = est->concatenation(single[i], suffix[i + 1], path[i], path[i + 1]);
+
+    double forward = 0;
+    for(uint32_t j = 0; j < n; j++) forward += prefix[j].noPaths;
+
+    // an entry expands the share of its sources reached by the neighbouring part of the path
+    auto share = [](double reached, uint32_t all) { return std::min(1.0, reached / std::max(all, 1u)); };
+    double passes = single[0].noPaths + single[n - 1].noPaths + (n + 1) * (graph->getNoVertices() / 64.0);
+    for(uint32_t i = 1; i < n; i++) passes += single[i].noPaths * share(prefix[i - 1].noIn, single[i].noOut);
+    for(uint32_t i = 0; i + 1 < n; i++) passes += single[i].noPaths * share(suffix[i + 1].noOut, single[i].noIn);
+
+    uint32_t middle = 0;
+    double best = forward;
+    for(uint32_t m = 1; m < n; m++) {
+        double cost = passes + prefix[n - 1].noPaths;
+        for(uint32_t j = 0; j < m; j++) cost += prefix[j].noPaths;
+        for(uint32_t j = m; j < n; j++) cost += suffix[j].noPaths;
+        if(cost < best) {
+            best = cost;
+            middle = m;
+        }
+    }
+    return middle;
 }
 
 /**
- * Perform a selection on a target constant.
- * @param s A target constant.
- * @param in A graph to select from.
- * @return An answer graph as a result of the given selection.
+ * The vertices that can occur at every position of a match of a path: bit v of on[i] is set iff some
+ * match of the whole path is at v after its first i entries. Computed with one pass of frontier
+ * expansion forward from the sources of the first entry, and one pass backward (over the reversed
+ * entries) from the vertices reached at the end, keeping only what both passes reach.
+ * @param path The path.
+ * @return n + 1 bitsets over the vertices.
  */
-std::shared_ptr<SimpleGraph> selectTarget(Identifier &t, std::shared_ptr<SimpleGraph> &in) {
+std::vector<std::vector<uint64_t>> SimpleEvaluator::matchVertices(const std::vector<PathEntry> &path) {
 
-    auto out = std::make_shared<SimpleGraph>(in->getNoVertices());
-    out->setNoLabels(in->getNoLabels());
+    auto n = (uint32_t) path.size();
+    auto noVertices = graph->getNoVertices();
+    std::vector<std::vector<uint32_t>> reached(n + 1);
 
-    for (int i = 0; i < in->SO.size(); ++i) {
-        for(auto trg : in->SO[i]){
-            if(trg == t){
-                out->addEdge(i, t, 0);
-            }
+    thread_local VisitedSet visited;
+    visited.clear(noVertices);
+    for(auto labelDir : path[0].labels) {
+        for(auto vertex : (labelDir.reverse ? graph->POS : graph->PSO).sources(labelDir.label)) {
+            if(visited.insert(vertex)) reached[0].push_back(vertex);
         }
     }
+    for(uint32_t i = 0; i < n; i++) {
+        visited.clear(noVertices);
+        expandEntry(reached[i], path[i], visited, reached[i + 1]);
+    }
 
-    return out;
+    std::vector<std::vector<uint64_t>> on(n + 1, std::vector<uint64_t>((noVertices + 63) / 64, 0));
+    for(auto vertex : reached[n]) on[n][vertex >> 6] |= 1ULL << (vertex & 63);
+
+    auto reversed = Triple {NO_IDENTIFIER, path, NO_IDENTIFIER}.reversed().path;
+    std::vector<uint32_t> next;
+    for(uint32_t i = n; i-- > 0;) {
+        visited.clear(noVertices);
+        next.clear();
+        expandEntry(reached[i + 1], reversed[n - 1 - i], visited, next);
+
+        reached[i].erase(std::remove_if(reached[i].begin(), reached[i].end(), [&](uint32_t vertex) {
+            return !visited.contains(vertex);
+        }), reached[i].end());
+        for(auto vertex : reached[i]) on[i][vertex >> 6] |= 1ULL << (vertex & 63);
+    }
+    return on;
+}
+
+/**
+ * Follow the first entries of a path from one vertex, dropping the vertices that lie on no match.
+ * @param start Start vertex.
+ * @param path The path, or the reversed path to follow the matches from their end.
+ * @param length Number of entries to follow.
+ * @param on Vertices per position of a match of the path as it is not reversed (see matchVertices).
+ * @param backward Whether path is reversed, so that its positions are looked up in on from the end.
+ * @param visited Scratch.
+ * @param frontier Receives the distinct vertices reached.
+ * @param next Scratch.
+ */
+void SimpleEvaluator::followMatches(uint32_t start, const std::vector<PathEntry> &path, uint32_t length,
+                                    const std::vector<std::vector<uint64_t>> &on, bool backward,
+                                    VisitedSet &visited, std::vector<uint32_t> &frontier, std::vector<uint32_t> &next) {
+    auto n = on.size() - 1;
+    frontier.assign(1, start);
+    for(uint32_t i = 0; i < length && !frontier.empty(); i++) {
+        visited.clear(graph->getNoVertices());
+        next.clear();
+        expandEntry(frontier, path[i], visited, next);
+
+        // inside a closure every vertex is kept, only where the entry ends is the next position checked
+        const auto &position = on[backward ? n - (i + 1) : i + 1];
+        frontier.clear();
+        for(auto vertex : next) {
+            if(position[vertex >> 6] >> (vertex & 63) & 1) frontier.push_back(vertex);
+        }
+    }
+}
+
+/**
+ * Count a concatenation from both ends. The vertices that lie on a match are found first (see
+ * matchVertices), so neither half expands anything that cannot reach the other. The suffix from the
+ * middle entry on is followed backward (over POS for forward labels) from every target into a relation
+ * middle vertex -> targets, the prefix is followed forward from every source and joined with that
+ * relation on the middle vertices it reaches. Both halves spread their start vertices over the thread
+ * pool; the forward half counts into partial counters (reused by the next block on any thread) that are
+ * merged at the end.
+ * @param path The concatenation.
+ * @param middle First entry of the backward half, 0 < middle < path.size().
+ * @param counter Sink for the answer.
+ */
+void SimpleEvaluator::countBidirectional(const std::vector<PathEntry> &path, uint32_t middle, CardinalityCounter &counter) {
+
+    auto n = (uint32_t) path.size();
+    auto noVertices = graph->getNoVertices();
+    auto on = matchVertices(path);
+    auto reversed = Triple {NO_IDENTIFIER, path, NO_IDENTIFIER}.reversed().path;
+
+    auto verticesOf = [](const std::vector<uint64_t> &bits) {
+        std::vector<uint32_t> vertices;
+        for(size_t i = 0; i < bits.size(); i++) {
+            for(auto word = bits[i]; word != 0; word &= word - 1) vertices.push_back((uint32_t) (i * 64 + __builtin_ctzll(word)));
+        }
+        return vertices;
+    };
+    auto sources = verticesOf(on[0]), targets = verticesOf(on[n]);
+
+    // backward half: (middle vertex, target) pairs, keyed so that sorting groups them by middle vertex
+    std::mutex lock;
+    std::vector<uint64_t> pairs;
+    pool->parallelFor(0, targets.size(), 256, [&](uint64_t first, uint64_t last) {
+        thread_local VisitedSet seen;
+        thread_local std::vector<uint32_t> frontier, next;
+        std::vector<uint64_t> part;
+        for(auto i = first; i < last; i++) {
+            followMatches(targets[i], reversed, n - middle, on, true, seen, frontier, next);
+            for(auto vertex : frontier) part.push_back(AdjacencyIndex::edgeKey(vertex, targets[i]));
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        pairs.insert(pairs.end(), part.begin(), part.end());
+    });
+    std::sort(pairs.begin(), pairs.end());
+
+    Relation::Builder builder(noVertices, 1);
+    {
+        Relation::Builder::Writer writer(builder, 0);
+        std::vector<uint32_t> row;
+        for(size_t i = 0; i < pairs.size();) {
+            auto vertex = (uint32_t) (pairs[i] >> 32);
+            row.clear();
+            for(; i < pairs.size() && (pairs[i] >> 32) == vertex; i++) row.push_back((uint32_t) pairs[i]);
+            writer.add(vertex, row.begin(), row.end());
+        }
+    }
+    auto right = builder.finish();
+    std::vector<uint64_t>().swap(pairs);
+
+    // forward half, joined with the backward half where they meet
+    auto partials = pool->parallelForPartials(0, sources.size(), 256, [&]() {
+        return std::make_unique<CardinalityCounter>(counter.emptyLike());
+    }, [&](CardinalityCounter &partial, uint64_t first, uint64_t last) {
+        thread_local VisitedSet seen, joined;
+        thread_local std::vector<uint32_t> frontier, next, scratch, row;
+        for(auto i = first; i < last; i++) {
+            followMatches(sources[i], path, middle, on, false, seen, frontier, next);
+            joined.clear(noVertices);
+            row.clear();
+            for(auto vertex : frontier) {
+                auto r = right->find(vertex);
+                if(r == Relation::NO_ROW) continue;
+                for(auto target : right->row(r, scratch)) {
+                    if(joined.insert(target)) row.push_back(target);
+                }
+            }
+            partial.addSource(row.begin(), row.end());
+        }
+    });
+
+    for(auto &partial : partials) counter.merge(*partial);
 }
 
 /**
  * Evaluate a path query. Produce a cardinality of the answer graph.
+ * Queries with a bound source are evaluated from that vertex outward, queries with a bound target are
+ * rewritten into the reversed path and evaluated from the target outward. Otherwise the concatenation is
+ * pushed through a pipeline along the join plan chosen by planJoins (see countPipelined) into a CardinalityCounter,
+ * so only the sub-plans that break the pipeline are materialized and the answer itself is never built. Long
+ * concatenations whose ends are estimated to be narrower than their middle are evaluated from both ends instead
+ * (see chooseMiddle and countBidirectional).
  * @param query Query to evaluate.
  * @return A cardinality statistics of the answer graph.
  */
-cardStat SimpleEvaluator::evaluate(Triple &query) {
-    auto res = evaluateConcat(query.path, query.toString());
-    if(query.src != NO_IDENTIFIER) res = selectSource(query.src, res);
-    else if(query.trg != NO_IDENTIFIER) res = selectTarget(query.trg, res);
-    return SimpleEvaluator::computeStats(res);
-}
\ No newline at end of file
+cardStat SimpleEvaluator::evaluate(const Triple &query) {
+
+    // bound source: start from the constant instead of evaluating the whole path
+    if(query.src != NO_IDENTIFIER) {
+        auto reached = evaluateFrom(query.src, query.path);
+        auto n = (uint32_t) reached.size();
+        if(query.trg != NO_IDENTIFIER) n = std::find(reached.begin(), reached.end(), query.trg) != reached.end();
+        return cardStat {n ? 1u : 0u, n, n};
+    }
+
+    // bound target: the reversed path (flipped directions, so it walks POS) from the target outward
+    if(query.trg != NO_IDENTIFIER) {
+        auto reversed = query.reversed();
+        auto reached = evaluateFrom(reversed.src, reversed.path);
+        auto n = (uint32_t) reached.size();
+        return cardStat {n, n, n ? 1u : 0u};
+    }
+
+    CardinalityCounter counter(graph->getNoVertices(), approximate);
+    auto &path = query.path;
+    auto n = (uint32_t) path.size();
+    auto &last = path.back();
+
+    if(n == 1) {
+        if(!last.kleene) {
+            countLabels(last, counter);
+            return counter.result();
+        }
+        // a closure is counted per strongly connected component, its pairs are never listed
+        return closureOf(last)->stats();
+    }
+
+    auto middle = chooseMiddle(path);
+    if(middle > 0) {
+        countBidirectional(path, middle, counter);
+        return counter.result();
+    }
+
+    countPipelined(path, planJoins(path), counter);
+    return counter.result();
+}
+
+/**
+ * Evaluate a workload at once, sharing work between its queries:
+ *  - identical queries are evaluated once, and the closure of a Kleene entry is condensed once
+ *  - the paths of the queries without bound endpoints are merged into trees of pipeline steps (see
+ *    PathPipeline): paths with a common prefix share the steps of that prefix, so each shared step runs
+ *    once per source for all of them. Paths are merged backwards from their targets (as reversed paths)
+ *    instead when they share a longer suffix than prefix with another path.
+ * Queries with a bound endpoint, and paths that share nothing, are evaluated one by one as by evaluate():
+ * from the constant outward, a bound query touches less than a shared pass over all sources.
+ * @param queries The workload.
+ * @return The answer of every query, in the order of the workload.
+ */
+std::vector<cardStat> SimpleEvaluator::evaluateBatch(const std::vector<Triple> &queries) {
+
+    ClosureMap closures;
+    BatchClosuresScope scope(closures);
+
+    // the distinct paths of the workload, each with the queries over it
+    struct PathGroup {
+        std::vector<PathEntry> path;             // reversed if merged backwards
+        std::vector<SubplanCache::Key> entries;  // key of every entry of path
+        std::vector<size_t> queries;
+        bool free = false;     // a query over the path has no bound endpoint
+        bool reversed = false;
+        bool merged = false;   // answered by a shared pipeline
+        cardStat answer {};    // of the free query, if merged
+    };
+    std::vector<PathGroup> groups;
+    std::unordered_map<SubplanCache::Key, size_t, SubplanCache::KeyHash> groupOf;
+
+    auto keysOf = [](const std::vector<PathEntry> &path) {
+        std::vector<SubplanCache::Key> keys;
+        for(auto &pe : path) keys.push_back(SubplanCache::keyOf(&pe, &pe + 1));
+        return keys;
+    };
+
+    for(size_t q = 0; q < queries.size(); q++) {
+        auto &path = queries[q].path;
+        auto key = SubplanCache::keyOf(path.data(), path.data() + path.size());
+        auto it = groupOf.find(key);
+        if(it == groupOf.end()) {
+            it = groupOf.emplace(key, groups.size()).first;
+            groups.emplace_back();
+            groups.back().path = path;
+            groups.back().entries = keysOf(path);
+        }
+        auto &group = groups[it->second];
+        group.queries.push_back(q);
+        group.free |= queries[q].src == NO_IDENTIFIER && queries[q].trg == NO_IDENTIFIER;
+    }
+
+    // merge every free path the way it shares more with another one
+    for(auto &g : groups) {
+        if(!g.free) continue;
+        uint32_t prefix = 0, suffix = 0;
+        for(auto &h : groups) {
+            if(&g == &h || !h.free) continue;
+            auto n = (uint32_t) std::min(g.entries.size(), h.entries.size());
+            uint32_t lcp = 0, lcs = 0;
+            while(lcp < n && g.entries[lcp] == h.entries[lcp]) lcp++;
+            while(lcs < n && g.entries[g.entries.size() - 1 - lcs] == h.entries[h.entries.size() - 1 - lcs]) lcs++;
+            prefix = std::max(prefix, lcp);
+            suffix = std::max(suffix, lcs);
+        }
+        g.reversed = suffix > prefix;
+    }
+    for(auto &g : groups) {
+        if(!g.reversed) continue;
+        g.path = Triple {NO_IDENTIFIER, g.path, NO_IDENTIFIER}.reversed().path;
+        g.entries = keysOf(g.path);
+    }
+
+    // one tree per direction and first entry, with a sink per path
+    struct Tree {
+        bool reversed;
+        std::vector<PathPipeline::Step> steps;
+        std::vector<SubplanCache::Key> entries; // of every step
+        std::vector<size_t> sinks;              // group of every sink
+    };
+    std::vector<Tree> trees;
+    auto treeOf = [&](const PathGroup &g) {
+        for(size_t t = 0; t < trees.size(); t++) {
+            if(trees[t].reversed == g.reversed && trees[t].entries[0] == g.entries[0]) return t;
+        }
+        trees.push_back({g.reversed, {}, {g.entries[0]}, {}});
+        return trees.size() - 1;
+    };
+    for(size_t i = 0; i < groups.size(); i++) {
+        if(groups[i].free) trees[treeOf(groups[i])].sinks.push_back(i);
+    }
+
+    for(auto &tree : trees) {
+        if(tree.sinks.size() < 2) continue;
+
+        tree.steps.push_back(pipelineStep(groups[tree.sinks[0]].path[0]));
+        for(uint32_t sink = 0; sink < tree.sinks.size(); sink++) {
+            auto &g = groups[tree.sinks[sink]];
+            uint32_t k = 0;
+            for(size_t e = 1; e < g.path.size(); e++) {
+                auto next = std::find_if(tree.steps[k].next.begin(), tree.steps[k].next.end(), [&](uint32_t c) {
+                    return tree.entries[c] == g.entries[e];
+                });
+                if(next != tree.steps[k].next.end()) {
+                    k = *next;
+                    continue;
+                }
+                auto c = (uint32_t) tree.steps.size();
+                tree.steps.push_back(pipelineStep(g.path[e]));
+                tree.entries.push_back(g.entries[e]);
+                tree.steps[k].next.push_back(c);
+                k = c;
+            }
+            tree.steps[k].sink = sink;
+        }
+
+        std::vector<CardinalityCounter> counters(tree.sinks.size(), CardinalityCounter(graph->getNoVertices(), approximate));
+        std::vector<CardinalityCounter *> sinks;
+        for(auto &counter : counters) sinks.push_back(&counter);
+        countSteps(tree.steps, sinks);
+
+        for(uint32_t sink = 0; sink < tree.sinks.size(); sink++) {
+            auto &g = groups[tree.sinks[sink]];
+            g.merged = true;
+            g.answer = counters[sink].result();
+            if(tree.reversed) std::swap(g.answer.noOut, g.answer.noIn);
+        }
+    }
+
+    std::vector<cardStat> answers(queries.size());
+    std::map<std::pair<Identifier, Identifier>, cardStat> done; // endpoints -> answer, per path
+    for(auto &g : groups) {
+        done.clear();
+        for(auto q : g.queries) {
+            auto &query = queries[q];
+            auto endpoints = std::make_pair(query.src, query.trg);
+            auto it = done.find(endpoints);
+            if(it != done.end()) {
+                answers[q] = it->second;
+                continue;
+            }
+            bool free = query.src == NO_IDENTIFIER && query.trg == NO_IDENTIFIER;
+            answers[q] = free && g.merged ? g.answer : evaluate(query);
+            done.emplace(endpoints, answers[q]);
+        }
+    }
+
+    return answers;
+}
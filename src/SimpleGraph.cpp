@@ -1,4 +1,10 @@
 #include "SimpleGraph.h"
+#include "MappedFile.h"
+#include "GraphParser.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
 
 SimpleGraph::SimpleGraph(uint32_t n)   {
     setNoVertices(n);
@@ -68,21 +74,19 @@ uint32_t SimpleGraph::getNoEdges() const {
 
 uint32_t SimpleGraph::getNoDistinctEdges() const {
     uint32_t sum = 0;
+    std::vector<uint32_t> sorted;
 
-    for (auto sourceVec : SO) {
+    for (const auto &sourceVec : SO) {
 
-        std::sort(sourceVec.begin(), sourceVec.end());
-
-        uint32_t prevTarget = 0;
-        bool first = true;
-
-        for (const auto &tgt : sourceVec) {
-            if (first || prevTarget != tgt ) {
-                first = false;
-                sum++;
-                prevTarget = tgt;
-            }
+        // rows built by the evaluator are already sorted and distinct
+        if (std::adjacent_find(sourceVec.begin(), sourceVec.end(), std::greater_equal<>()) == sourceVec.end()) {
+            sum += sourceVec.size();
+            continue;
         }
+
+        sorted.assign(sourceVec.begin(), sourceVec.end());
+        std::sort(sorted.begin(), sorted.end());
+        sum += std::unique(sorted.begin(), sorted.end()) - sorted.begin();
     }
 
     return sum;
@@ -114,42 +118,128 @@ bool SimpleGraph::edgeExists(uint32_t from, uint32_t to, uint32_t edgeLabel) {
 //    return (it != adj[from].end());
 }
 
+/**
+ * Replace the out-edges of a vertex, e.g. with a sorted and duplicate-free list built by an operator.
+ * @param from Source vertex.
+ * @param targets New targets of the source.
+ */
+void SimpleGraph::setEdges(uint32_t from, std::vector<uint32_t> &&targets) {
+    if(from >= V)
+        throw std::runtime_error(std::string("Edge data out of bounds: ") + std::to_string(from));
+    for(auto to : targets) trgBitMap[to] = '1';
+    SO[from] = std::move(targets);
+}
+
 void SimpleGraph::readFromContiguousFile(const std::string &fileName) {
+    readFromContiguousFile(fileName, 1);
+}
+
+/**
+ * Parse edge data of a (part of a) graph file into per-label buckets.
+ * @param parser Parser positioned at the first edge line of the part.
+ * @param pso Per-label (subject, object) buckets to append to.
+ */
+void SimpleGraph::parseEdges(GraphParser &parser, EdgeBuckets &pso) const {
+    uint32_t subject, predicate, object;
+    while(parser.nextEdge(subject, predicate, object)) {
+        if(subject >= V || object >= V || predicate >= L)
+            throw std::runtime_error(std::string("Edge data out of bounds: ") +
+                                     "(" + std::to_string(subject) + "," + std::to_string(object) + "," +
+                                     std::to_string(predicate) + ")");
+
+        pso[predicate].push_back(AdjacencyIndex::edgeKey(subject, object));
+    }
+}
+
+/**
+ * Read a graph file, parsing the edge data with multiple threads.
+ * The file is split into one chunk per thread at line boundaries and each thread fills its own per-label buckets.
+ * The buckets of a label are then concatenated by the thread owning that label and turned into the PSO CSR,
+ * POS is built by transposing PSO. Since the CSR is sorted the result does not depend on the number of threads.
+ * @param fileName Graph file (graph.nt format).
+ * @param noThreads Number of parsing threads, 0 means one per hardware thread.
+ */
+void SimpleGraph::readFromContiguousFile(const std::string &fileName, uint32_t noThreads) {
 
-    std::string line;
-    std::ifstream graphFile { fileName };
+    MappedFile graphFile { fileName };
+    graphFile.adviseSequential();
 
-    std::regex edgePat (R"((\d+)\s(\d+)\s(\d+)\s\.)"); // subject predicate object .
-    std::regex headerPat (R"((\d+),(\d+),(\d+))"); // noNodes,noEdges,noLabels
+    const char *end = graphFile.data() + graphFile.size();
+    GraphParser parser(graphFile.data(), end);
 
     // parse the header (1st line)
-    std::getline(graphFile, line);
-    std::smatch matches;
-    if(std::regex_search(line, matches, headerPat)) {
-        uint32_t noNodes = (uint32_t) std::stoul(matches[1]);
-        uint32_t noLabels = (uint32_t) std::stoul(matches[3]);
-
-        setNoVertices(noNodes);
-        setNoLabels(noLabels);
-    } else {
-        throw std::runtime_error(std::string("Invalid graph header!"));
-    }
+    auto header = parser.header();
+    setNoVertices(header.noNodes);
+    setNoLabels(header.noLabels);
 
-    // parse edge data
-    while(std::getline(graphFile, line)) {
-        if(std::regex_search(line, matches, edgePat)) {
-            uint32_t subject = (uint32_t) std::stoul(matches[1]);
-            uint32_t predicate = (uint32_t) std::stoul(matches[2]);
-            uint32_t object = (uint32_t) std::stoul(matches[3]);
+    if(noThreads == 0) noThreads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t indexThreads = noThreads;
+    const char *body = parser.position();
+    // not worth spawning parser threads for small files
+    noThreads = (uint32_t) std::min<size_t>(noThreads, 1 + (end - body) / (1 << 16));
 
-//            addEdge(subject, object, predicate);
+    EdgeBuckets pso(L);
 
-            PSO[predicate].push_back(std::pair<uint32_t, uint32_t>(subject, object));
-            POS[predicate].push_back(std::pair<uint32_t, uint32_t>(object, subject));
+    if(noThreads == 1) {
+        parseEdges(parser, pso);
+    } else {
+        // split the edge data at line boundaries
+        std::vector<const char *> bounds(noThreads + 1, end);
+        bounds[0] = body;
+        for(uint32_t i = 1; i < noThreads; i++) {
+            const char *split = std::max(bounds[i - 1], body + (end - body) / noThreads * i);
+            auto nl = static_cast<const char *>(std::memchr(split, '\n', end - split));
+            bounds[i] = nl ? nl + 1 : end;
         }
-    }
 
+        // parse the chunks
+        std::vector<EdgeBuckets> parts(noThreads, EdgeBuckets(L));
+        std::vector<uint64_t> lines(noThreads, 0);
+        std::vector<char> failed(noThreads, 0);
+        std::vector<std::thread> workers;
+        for(uint32_t i = 0; i < noThreads; i++) {
+            workers.emplace_back([&, i]() {
+                GraphParser chunk(bounds[i], bounds[i + 1], 0);
+                try {
+                    parseEdges(chunk, parts[i]);
+                } catch (std::runtime_error &) {
+                    failed[i] = 1;
+                }
+                lines[i] = chunk.line();
+            });
+        }
+        for(auto &w : workers) w.join();
+        workers.clear();
+
+        // report the first malformed chunk by re-parsing it with the right line numbers
+        uint64_t firstLine = parser.line();
+        for(uint32_t i = 0; i < noThreads; i++) {
+            if(failed[i]) {
+                GraphParser chunk(bounds[i], bounds[i + 1], firstLine);
+                EdgeBuckets dummy(L);
+                parseEdges(chunk, dummy);
+            }
+            firstLine += lines[i];
+        }
 
-    graphFile.close();
+        // merge: thread i concatenates the buckets of the labels l with l % noThreads == i
+        for(uint32_t i = 0; i < noThreads; i++) {
+            workers.emplace_back([&, i]() {
+                for(uint32_t label = i; label < L; label += noThreads) {
+                    size_t total = 0;
+                    for(auto &part : parts) total += part[label].size();
+                    pso[label].reserve(total);
+                    for(auto &part : parts) {
+                        pso[label].insert(pso[label].end(), part[label].begin(), part[label].end());
+                        EdgeBuckets::value_type().swap(part[label]);
+                    }
+                }
+            });
+        }
+        for(auto &w : workers) w.join();
+    }
 
-}
\ No newline at end of file
+    PSO.build(pso, indexThreads);
+    POS.buildTransposed(PSO, indexThreads);
+
+}
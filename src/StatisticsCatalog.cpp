@@ -0,0 +1,149 @@
+#include "StatisticsCatalog.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+void StatisticsCatalog::build(const SimpleGraph &g, uint32_t noThreads) {
+
+    auto noLabels = g.getNoLabels();
+    graph = &g;
+    noVertices = g.getNoVertices();
+    labels.assign(noLabels, {});
+    histograms.assign((size_t) 2 * noLabels * NO_BUCKETS, 0);
+    sketches.assign((size_t) 2 * noLabels, HyperLogLog(SKETCH_PRECISION));
+    pairSketches.assign(noLabels, HyperLogLog(SKETCH_PRECISION));
+    reversedPairSketches.assign(noLabels, HyperLogLog());
+    reversedPairsBuilt = std::make_unique<std::once_flag[]>(noLabels);
+    reversedPairBytes = 0;
+
+    // vertices with an edge of any label, per direction; bits of different labels share words
+    auto noWords = ((size_t) noVertices + 63) / 64;
+    std::unique_ptr<std::atomic<uint64_t>[]> seen[2] {
+        std::make_unique<std::atomic<uint64_t>[]>(noWords), std::make_unique<std::atomic<uint64_t>[]>(noWords)
+    };
+    for(auto &bits : seen) {
+        for(size_t w = 0; w < noWords; w++) bits[w].store(0, std::memory_order_relaxed);
+    }
+
+    // every (label, direction) is split into ranges of its vertices of about MAX_TASK_EDGES edges, each
+    // collecting into a partial of its own that is merged into the label's statistics afterwards
+    struct Task {
+        uint32_t label;
+        bool reverse;
+        size_t first, last; // range of the label's vertices
+    };
+    struct Partial {
+        uint32_t histogram[NO_BUCKETS] = {};
+        uint32_t maxDegree = 0;
+        HyperLogLog sketch, pairSketch;
+    };
+    std::vector<Task> tasks;
+    for(uint32_t label = 0; label < noLabels; label++) {
+        for(bool reverse : {false, true}) {
+            const auto &index = reverse ? g.POS : g.PSO;
+            uint64_t n = index.sources(label).size();
+            auto noParts = std::min(n, (index.getNoEdges(label) + MAX_TASK_EDGES - 1) / MAX_TASK_EDGES);
+            noParts = std::max<uint64_t>(noParts, 1);
+            for(uint64_t part = 0; part < noParts; part++) {
+                tasks.push_back({label, reverse, n * part / noParts, n * (part + 1) / noParts});
+            }
+        }
+    }
+    std::vector<Partial> partials(tasks.size());
+
+    // a small graph is done before the threads would have started
+    if(g.PSO.vertices.size() + g.POS.vertices.size() < MIN_PARALLEL_VERTICES) noThreads = 1;
+    ThreadPool pool(noThreads);
+    pool.parallelFor(0, tasks.size(), 1, [&](uint64_t first, uint64_t last) {
+        for(auto t = first; t < last; t++) {
+            auto &task = tasks[t];
+            const auto &index = task.reverse ? g.POS : g.PSO;
+            auto &bits = seen[task.reverse];
+            auto &partial = partials[t];
+            partial.sketch = HyperLogLog(SKETCH_PRECISION);
+            // the pairs as (source, target) only, the other way round they are sketched on first use
+            if(!task.reverse) partial.pairSketch = HyperLogLog(SKETCH_PRECISION);
+
+            // the vertices are ascending: collect the bits of one word, publish them once the word is done
+            auto vertices = index.sources(task.label);
+            auto offset = index.labelOffsets[task.label];
+            auto edgeOffsets = index.edgeOffsets.begin() + offset;
+            uint64_t word = 0;
+            size_t w = 0;
+            for(auto i = task.first; i < task.last; i++) {
+                auto degree = (uint32_t) (edgeOffsets[i + 1] - edgeOffsets[i]);
+                partial.histogram[31 - __builtin_clz(degree)]++;
+                partial.maxDegree = std::max(partial.maxDegree, degree);
+
+                auto v = vertices[i];
+                partial.sketch.insert(v);
+                if(!task.reverse) {
+                    for(auto u : index.neighboursAt(offset + i)) partial.pairSketch.insert((uint64_t) v << 32 | u);
+                }
+                if(v / 64 != w) {
+                    if(word) bits[w].fetch_or(word, std::memory_order_relaxed);
+                    w = v / 64;
+                    word = 0;
+                }
+                word |= 1ULL << (v % 64);
+            }
+            if(word) bits[w].fetch_or(word, std::memory_order_relaxed);
+        }
+    });
+
+    for(size_t t = 0; t < tasks.size(); t++) {
+        auto &task = tasks[t];
+        auto &partial = partials[t];
+        auto &stats = labels[task.label];
+        auto histogram = histograms.data() + (2 * task.label + task.reverse) * NO_BUCKETS;
+        for(uint32_t b = 0; b < NO_BUCKETS; b++) histogram[b] += partial.histogram[b];
+        sketches[2 * task.label + task.reverse].merge(partial.sketch);
+        if(task.reverse) {
+            stats.maxInDegree = std::max(stats.maxInDegree, partial.maxDegree);
+        } else {
+            pairSketches[task.label].merge(partial.pairSketch);
+            stats.maxOutDegree = std::max(stats.maxOutDegree, partial.maxDegree);
+        }
+    }
+    for(uint32_t label = 0; label < noLabels; label++) {
+        auto &stats = labels[label];
+        stats.noSources = (uint32_t) g.PSO.sources(label).size();
+        stats.noTargets = (uint32_t) g.POS.sources(label).size();
+        stats.noPairs = g.PSO.getNoEdges(label);
+    }
+
+    noSources = noTargets = 0;
+    for(size_t w = 0; w < noWords; w++) {
+        noSources += (uint32_t) __builtin_popcountll(seen[0][w].load(std::memory_order_relaxed));
+        noTargets += (uint32_t) __builtin_popcountll(seen[1][w].load(std::memory_order_relaxed));
+    }
+    noPairs = g.PSO.getNoEdges();
+}
+
+/**
+ * The sketch of the pairs of a label. The (target, source) pairs are sketched from POS the first time they
+ * are asked for, which is safe from several threads at once.
+ * @param label The label.
+ * @param reverse Whether the pairs are (target, source).
+ * @return The sketch, empty for an unknown label.
+ */
+const HyperLogLog &StatisticsCatalog::pairSketch(uint32_t label, bool reverse) const {
+    static const HyperLogLog none(SKETCH_PRECISION);
+    if(label >= labels.size()) return none;
+    if(!reverse) return pairSketches[label];
+
+    std::call_once(reversedPairsBuilt[label], [&]() {
+        const auto &index = graph->POS;
+        HyperLogLog sketch(SKETCH_PRECISION);
+        auto vertices = index.sources(label);
+        auto offset = index.labelOffsets[label];
+        for(size_t i = 0; i < vertices.size(); i++) {
+            for(auto u : index.neighboursAt(offset + i)) sketch.insert((uint64_t) vertices[i] << 32 | u);
+        }
+        reversedPairBytes += sketch.getNoBytes();
+        reversedPairSketches[label] = std::move(sketch);
+    });
+    return reversedPairSketches[label];
+}
@@ -0,0 +1,147 @@
+#include "SubplanCache.h"
+
+#include <algorithm>
+
+namespace {
+
+    // FNV-1a over the words
+    uint64_t hashOf(const std::vector<uint32_t> &words) {
+        uint64_t hash = 14695981039346656037ULL;
+        for(auto word : words) {
+            hash ^= word;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // ends the words of a condensed closure, no entry header has all bits set
+    const uint32_t CONDENSED = UINT32_MAX;
+
+}
+
+SubplanCache::Key SubplanCache::keyOf(const PathEntry *first, const PathEntry *last) {
+
+    Key key;
+    std::vector<uint32_t> labels;
+    for(auto pe = first; pe != last; ++pe) {
+        labels.clear();
+        for(auto labelDir : pe->labels) labels.push_back((uint32_t) labelDir.label << 1 | labelDir.reverse);
+        std::sort(labels.begin(), labels.end());
+        labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+
+        key.words.push_back((pe->kleene ? 1u << 31 : 0u) | (uint32_t) labels.size());
+        key.words.insert(key.words.end(), labels.begin(), labels.end());
+    }
+
+    key.hash = hashOf(key.words);
+    return key;
+}
+
+SubplanCache::Key SubplanCache::condensedKeyOf(const PathEntry &pe) {
+    auto key = keyOf(&pe, &pe + 1);
+    key.words.push_back(CONDENSED);
+    key.hash = hashOf(key.words);
+    return key;
+}
+
+std::shared_ptr<Relation> SubplanCache::find(const Key &key) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto entry = lookup(key);
+    return entry ? entry->relation : nullptr;
+}
+
+std::shared_ptr<CondensedClosure> SubplanCache::findClosure(const Key &key) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto entry = lookup(key);
+    return entry ? entry->closure : nullptr;
+}
+
+void SubplanCache::insert(const Key &key, std::shared_ptr<Relation> relation, double cost) {
+    // a cached relation is probed by later joins: its lookup array is built now and charged with it.
+    // Building it takes O(V), so it happens before the lock is taken
+    relation->buildLookup();
+    auto noBytes = relation->getNoBytes();
+
+    std::lock_guard<std::mutex> guard(lock);
+    keep(key, Entry {std::move(relation), nullptr, noBytes, 0, 0}, cost);
+}
+
+void SubplanCache::insert(const Key &key, std::shared_ptr<CondensedClosure> closure, double cost) {
+    auto noBytes = closure->getNoBytes();
+
+    std::lock_guard<std::mutex> guard(lock);
+    keep(key, Entry {nullptr, std::move(closure), noBytes, 0, 0}, cost);
+}
+
+/**
+ * Find an entry and renew its priority. The lock must be held.
+ * @param key Key of the entry.
+ * @return The entry, or nullptr (counted as a miss).
+ */
+const SubplanCache::Entry *SubplanCache::lookup(const Key &key) {
+    auto it = entries.find(key);
+    if(it == entries.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+
+    auto &entry = it->second;
+    byPriority.erase({entry.priority, &it->first});
+    entry.priority = clock + entry.costPerByte;
+    byPriority.emplace(entry.priority, &it->first);
+    return &entry;
+}
+
+/**
+ * Keep an entry (replacing one with the same key), evicting others to stay within the budget.
+ * The lock must be held.
+ * @param key Key of the entry.
+ * @param entry The entry, with its size set.
+ * @param cost Compute time of the entry in nanoseconds.
+ */
+void SubplanCache::keep(const Key &key, Entry entry, double cost) {
+
+    auto existing = entries.find(key);
+    if(existing != entries.end()) erase(existing);
+
+    entry.noBytes = std::max<uint64_t>(entry.noBytes, 1);
+    if(entry.noBytes > budget) return;
+
+    evictDownTo(budget - entry.noBytes);
+
+    entry.costPerByte = cost / (double) entry.noBytes;
+    entry.priority = clock + entry.costPerByte;
+    auto noBytes = entry.noBytes;
+    auto it = entries.emplace(key, std::move(entry)).first;
+    byPriority.emplace(it->second.priority, &it->first);
+    stats.noBytes += noBytes;
+    stats.noEntries++;
+}
+
+void SubplanCache::setBudget(uint64_t bytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    budget = bytes;
+    evictDownTo(budget);
+}
+
+SubplanCache::Stats SubplanCache::getStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void SubplanCache::evictDownTo(uint64_t noBytes) {
+    while(stats.noBytes > noBytes) {
+        auto victim = byPriority.begin();
+        clock = victim->first;
+        erase(entries.find(*victim->second));
+        stats.evictions++;
+    }
+}
+
+void SubplanCache::erase(std::unordered_map<Key, Entry, KeyHash>::iterator it) {
+    byPriority.erase({it->second.priority, &it->first});
+    stats.noBytes -= it->second.noBytes;
+    stats.noEntries--;
+    entries.erase(it);
+}
@@ -0,0 +1,95 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t noThreads) {
+    if(noThreads == 0) noThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(uint32_t i = 0; i < noThreads; i++) queues.push_back(std::make_unique<TaskQueue>());
+    for(uint32_t i = 1; i < noThreads; i++) workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto &w : workers) w.join();
+}
+
+void ThreadPool::push(size_t queue, const void *job, std::function<void()> task) {
+    noQueued++;
+    {
+        std::lock_guard<std::mutex> guard(queues[queue]->lock);
+        queues[queue]->tasks.push_back({job, std::move(task)});
+    }
+
+    // taking the lock orders the wake-up after the check of a worker that is about to sleep
+    std::lock_guard<std::mutex> guard(sleepLock);
+    wake.notify_all();
+}
+
+/**
+ * Take a task: the newest of the own queue, otherwise the oldest of another queue.
+ * @param self Queue of the calling thread.
+ * @param task Receives the task.
+ * @return false if all queues are empty.
+ */
+bool ThreadPool::tryPop(size_t self, std::function<void()> &task) {
+    {
+        std::lock_guard<std::mutex> guard(queues[self]->lock);
+        auto &own = queues[self]->tasks;
+        if(!own.empty()) {
+            task = std::move(own.back().run);
+            own.pop_back();
+            noQueued--;
+            return true;
+        }
+    }
+
+    for(size_t i = 1; i < queues.size(); i++) {
+        auto &victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front().run);
+            victim.tasks.pop_front();
+            noQueued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Take a task of one job from any queue, the oldest first. Tasks of other jobs are left alone.
+ * @param job The job (parallelFor call) the task must belong to.
+ * @param task Receives the task.
+ * @return false if no task of the job is queued.
+ */
+bool ThreadPool::tryPopOf(const void *job, std::function<void()> &task) {
+    for(auto &queue : queues) {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        auto &tasks = queue->tasks;
+        auto it = std::find_if(tasks.begin(), tasks.end(), [job](const Task &t) { return t.job == job; });
+        if(it != tasks.end()) {
+            task = std::move(it->run);
+            tasks.erase(it);
+            noQueued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(size_t self) {
+    std::function<void()> task;
+    while(true) {
+        if(tryPop(self, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this]() { return stopping || noQueued > 0; });
+        if(stopping && noQueued == 0) return;
+    }
+}
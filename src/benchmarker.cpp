@@ -27,34 +27,100 @@ void findBenchmarks(std::vector<std::pair<std::string, std::string>>& benchmarks
 	}
 }
 
+/**
+ * Rerun a workload with every thread count of --speedup and print the per-query speedup over the first one.
+ * @param benchmark (graph, queries) of the workload.
+ * @param config Benchmark options.
+ * @param result Replaced by the result of the run with the first thread count.
+ */
+void reportSpeedup(std::pair<std::string, std::string>& benchmark, const struct benchconfig_t &config, struct benchresult_t &result) {
+	std::vector<struct benchresult_t> runs;
+	for (auto noThreads : config.speedupThreads) {
+		auto runConfig = config;
+		runConfig.evalThreads = noThreads;
+		runs.push_back(evaluatorBench(benchmark.first, benchmark.second, runConfig));
+	}
+	result = runs.front();
+	
+	std::cout << "\n\nEval time per query (ms) and speedup over " << config.speedupThreads.front() << " thread(s):" << std::endl;
+	std::cout << "threads";
+	for (auto noThreads : config.speedupThreads) std::cout << "\t" << noThreads;
+	std::cout << std::endl;
+	
+	for (size_t q = 0; q < result.queryTimes.size(); q++) {
+		auto base = result.queryTimes[q].second;
+		for (auto& run : runs) {
+			if (q >= run.queryTimes.size()) continue;
+			auto time = run.queryTimes[q].second;
+			std::cout << "\t" << time << " ms";
+			if (base > 0 && time > 0) std::cout << " (x" << double(base) / double(time) << ")";
+		}
+		std::cout << "\t" << result.queryTimes[q].first << std::endl;
+	}
+}
+
 int main(int argc, char *argv[]) {
 
     if(argc < 2) {
-        std::cout << "Usage: benchmarker <workloaddir>" << std::endl;
+        std::cout << "Usage: benchmarker <workloaddir> [options]" << std::endl;
+        printBenchOptions();
         return 0;
     }
 
     // args
     std::string workloadDir {argv[1]};
+
+    struct benchconfig_t config {};
+    if(!parseBenchOptions(argc, argv, 2, config)) return 1;
     
     std::vector<std::pair<std::string, std::string>> benchmarks;
     
     findBenchmarks(benchmarks, workloadDir);
 	
+    if (config.mode == "estimator") {
+    	std::vector<struct estimatorresult_t> results;
+    	for (auto& benchmark : benchmarks) {
+    		std::cout << "\n=== Benchmark " << benchmark.first << " + " << benchmark.second << "===" << std::endl;
+    		results.push_back(estimatorBench(benchmark.first, benchmark.second, config));
+    	}
+    	
+    	std::cout << std::endl << std::endl << std::endl << "All workloads:";
+    	printEstimatorSummary(results);
+    	if (!config.jsonFile.empty() && !writeEstimatorJson(config.jsonFile, results, config)) {
+    		std::cerr << "Could not write " << config.jsonFile << std::endl;
+    		return 1;
+    	}
+    	double memoryUsage = double(getPeakRSS()) / 1024.0 / 1024.0;
+    	std::cout << "Peak memory usage (for all workloads): " << memoryUsage << " MiB" << std::endl;
+    	return 0;
+    }
+	
     struct benchresult_t result = {};
     for (auto& benchmark : benchmarks) {
     	std::cout << "\n=== Benchmark " << benchmark.first << " + " << benchmark.second << "===" << std::endl;
     	
-    	auto result1 = evaluatorBench(benchmark.first, benchmark.second);
+    	auto result1 = evaluatorBench(benchmark.first, benchmark.second, config);
+    	
+    	if (!config.speedupThreads.empty()) {
+    		reportSpeedup(benchmark, config, result1);
+    	}
     	
     	std::cout << std::endl << std::endl;
     	result.loadTime += result1.loadTime;
     	result.evalTime += result1.evalTime;
     	result.prepTime += result1.prepTime;
+    	result.textualEvalTime += result1.textualEvalTime;
+    	result.automatonEvalTime += result1.automatonEvalTime;
     	
     	std::cout << "Total load time (for this benchmark): " << result1.loadTime << " ms" << std::endl;
     	std::cout << "Total prep time (for this benchmark): " << result1.prepTime << " ms" << std::endl;
     	std::cout << "Total eval time (for this benchmark): " << result1.evalTime << " ms" << std::endl;
+    	if (config.joinOrder == "compare") {
+    		std::cout << "Total eval time, textual join order (for this benchmark): " << result1.textualEvalTime << " ms" << std::endl;
+    	}
+    	if (config.engine == "compare") {
+    		std::cout << "Total eval time, automaton engine (for this benchmark): " << result1.automatonEvalTime << " ms" << std::endl;
+    	}
     }
     
 
@@ -62,6 +128,12 @@ int main(int argc, char *argv[]) {
     std::cout << "Total load time: " << result.loadTime << " ms" << std::endl;
     std::cout << "Total prep time: " << result.prepTime << " ms" << std::endl;
     std::cout << "Total eval time: " << result.evalTime << " ms" << std::endl;
+    if (config.joinOrder == "compare") {
+        std::cout << "Total eval time, textual join order: " << result.textualEvalTime << " ms" << std::endl;
+    }
+    if (config.engine == "compare") {
+        std::cout << "Total eval time, automaton engine: " << result.automatonEvalTime << " ms" << std::endl;
+    }
     double memoryUsage = double(getPeakRSS()) / 1024.0 / 1024.0;
     std::cout << "Peak memory usage (for all workloads): " << memoryUsage << " MiB" << std::endl;
     
@@ -5,20 +5,46 @@
 int main(int argc, char *argv[]) {
 
     if(argc < 3) {
-        std::cout << "Usage: quicksilver <graphFile> <queriesFile>" << std::endl;
+        std::cout << "Usage: quicksilver <graphFile> <queriesFile> [options]" << std::endl;
+        std::cout << "       quicksilver convert <graphFile> <snapshotFile> [options]" << std::endl;
+        printBenchOptions();
         return 0;
     }
 
+    if(std::string(argv[1]) == "convert") {
+        if(argc < 4) {
+            std::cout << "Usage: quicksilver convert <graphFile> <snapshotFile> [options]" << std::endl;
+            return 0;
+        }
+        std::string graphFile {argv[2]};
+        std::string snapshotFile {argv[3]};
+
+        struct benchconfig_t config {};
+        if(!parseBenchOptions(argc, argv, 4, config)) return 1;
+        return convertGraph(graphFile, snapshotFile, config);
+    }
+
     // args
     std::string graphFile {argv[1]};
     std::string queriesFile {argv[2]};
 
+    struct benchconfig_t config {};
+    if(!parseBenchOptions(argc, argv, 3, config)) return 1;
+
     // or manually give the directory
 //    std::string graphFile = " ";
 //    std::string queriesFile = "";
 
-//    estimatorBench(graphFile, queriesFile);
-    evaluatorBench(graphFile, queriesFile);
+    if(config.mode == "estimator") {
+        auto result = estimatorBench(graphFile, queriesFile, config);
+        if(!config.jsonFile.empty() && !writeEstimatorJson(config.jsonFile, {result}, config)) {
+            std::cerr << "Could not write " << config.jsonFile << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    evaluatorBench(graphFile, queriesFile, config);
 
     return 0;
 }
\ No newline at end of file